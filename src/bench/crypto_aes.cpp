@@ -0,0 +1,35 @@
+// Copyright (c) 2020 The Firo Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "random.h"
+#include "crypto/aes.h"
+
+#include <vector>
+
+/* Number of JMint amounts to decrypt per iteration */
+static const size_t MINT_AMOUNTS = 1000;
+
+// Decrypts JMint amounts the way CWallet::DecryptMintAmounts does once the
+// keys are cached: a key schedule and a single block per output.
+static void AES256_MintAmountDecrypt(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    std::vector<unsigned char> keys(MINT_AMOUNTS * AES256_KEYSIZE);
+    std::vector<unsigned char> ciphertexts(MINT_AMOUNTS * AES_BLOCKSIZE);
+    for (auto& c : keys)
+        c = rng.rand32();
+    for (auto& c : ciphertexts)
+        c = rng.rand32();
+
+    unsigned char plaintext[AES_BLOCKSIZE];
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < MINT_AMOUNTS; i++) {
+            AES256Decrypt dec(&keys[i * AES256_KEYSIZE]);
+            dec.Decrypt(plaintext, &ciphertexts[i * AES_BLOCKSIZE]);
+        }
+    }
+}
+
+BENCHMARK(AES256_MintAmountDecrypt);
@@ -0,0 +1,299 @@
+#include "bench.h"
+
+#include "hash.h"
+#include "liblelantus/challenge_generator_impl.h"
+#include "liblelantus/lelantus_prover.h"
+#include "liblelantus/lelantus_verifier.h"
+#include "liblelantus/params.h"
+#include "liblelantus/range_prover.h"
+#include "liblelantus/range_verifier.h"
+#include "liblelantus/schnorr_prover.h"
+#include "liblelantus/schnorr_verifier.h"
+#include "liblelantus/sigmaextended_prover.h"
+#include "liblelantus/sigmaextended_verifier.h"
+
+using namespace lelantus;
+
+namespace {
+
+//! Number of proofs checked together by the batch verification benches
+static const size_t LELANTUS_BATCH_SIZE = 8;
+//! Outputs per range proof; each output needs two range checks
+static const size_t RANGE_OUTPUTS = 2;
+
+//! Derive the i-th member of a fixed-seed stream so every run measures the same inputs
+static uint256 SeedHash(uint32_t seed, uint64_t i)
+{
+    return (CHashWriter(SER_GETHASH, 0) << seed << i).GetHash();
+}
+
+static Scalar SeedScalar(uint32_t seed, uint64_t i)
+{
+    uint256 hash = SeedHash(seed, i);
+    Scalar result;
+    result.memberFromSeed(hash.begin());
+    return result;
+}
+
+/**
+ * A full anonymity set of the default lelantus parameters (N = n^m, 65,536
+ * coins). The first LELANTUS_BATCH_SIZE coins are double commitments to the
+ * seeded (s, v, r) triples below; the rest are seeded group elements.
+ */
+struct AnonymitySet
+{
+    const Params* params;
+    size_t n, m, N;
+    std::vector<GroupElement> coins;
+    std::vector<Scalar> serials, values, randoms;
+
+    AnonymitySet() : params(Params::get_default())
+    {
+        n = params->get_sigma_n();
+        m = params->get_sigma_m();
+        N = 1;
+        for (size_t i = 0; i < m; ++i)
+            N *= n;
+
+        coins.resize(N);
+        for (size_t i = 0; i < N; ++i) {
+            uint256 seed = SeedHash(1, i);
+            coins[i].generate(seed.begin());
+        }
+
+        const std::vector<GroupElement>& h = params->get_sigma_h();
+        for (size_t i = 0; i < LELANTUS_BATCH_SIZE; ++i) {
+            serials.push_back(SeedScalar(2, i));
+            values.push_back(SeedScalar(3, i));
+            randoms.push_back(SeedScalar(4, i));
+            coins[i] = LelantusPrimitives::double_commit(
+                params->get_g(), serials[i], h[1], values[i], h[0], randoms[i]);
+        }
+    }
+
+    //! One-of-many proof that coin `l` is in the set, bound to challenge `x`
+    SigmaExtendedProof Prove(size_t l, const Scalar& x) const
+    {
+        SigmaExtendedProver prover(params->get_g(), params->get_sigma_h(), n, m);
+
+        GroupElement gs = params->get_g() * serials[l].negate();
+        std::vector<GroupElement> commits(coins);
+        for (auto& c : commits)
+            c += gs;
+
+        std::vector<Scalar> a(n * m), Tk(m), Pk(m), Yk(m), sigma;
+        Scalar rA = SeedScalar(5, 4 * l), rB = SeedScalar(5, 4 * l + 1);
+        Scalar rC = SeedScalar(5, 4 * l + 2), rD = SeedScalar(5, 4 * l + 3);
+
+        SigmaExtendedProof proof;
+        prover.sigma_commit(commits, l, rA, rB, rC, rD, a, Tk, Pk, Yk, sigma, proof);
+        prover.sigma_response(sigma, a, rA, rB, rC, rD, values[l], randoms[l], Tk, Pk, x, proof);
+        return proof;
+    }
+};
+
+static const AnonymitySet& GetAnonymitySet()
+{
+    static const AnonymitySet set;
+    return set;
+}
+
+//! Aggregated range proof over RANGE_OUTPUTS seeded outputs, using the consensus generators
+struct RangeSetup
+{
+    const Params* params;
+    size_t n, m;
+    std::vector<GroupElement> g, h;
+
+    RangeSetup() : params(Params::get_default())
+    {
+        n = params->get_bulletproofs_n();
+        m = RANGE_OUTPUTS * 2;
+        g.assign(params->get_bulletproofs_g().begin(), params->get_bulletproofs_g().begin() + n * m);
+        h.assign(params->get_bulletproofs_h().begin(), params->get_bulletproofs_h().begin() + n * m);
+    }
+
+    RangeProof Prove(uint32_t seed, std::vector<GroupElement>& V) const
+    {
+        std::vector<Scalar> v, serials, randoms;
+        V.clear();
+        for (size_t i = 0; i < m; ++i) {
+            v.push_back(Scalar(uint64_t(seed * m + i + 1)));
+            serials.push_back(SeedScalar(6 + seed, 2 * i));
+            randoms.push_back(SeedScalar(6 + seed, 2 * i + 1));
+            V.push_back(params->get_h1() * v.back() + params->get_h0() * randoms.back() + params->get_g() * serials.back());
+        }
+
+        RangeProver prover(params->get_h1(), params->get_h0(), params->get_g(), g, h, n, LELANTUS_TX_VERSION_4_5);
+        RangeProof proof;
+        prover.proof(v, serials, randoms, V, proof);
+        return proof;
+    }
+};
+
+/**
+ * End-to-end joinsplit: one input spent from the full anonymity set, two outputs.
+ * PrivateCoin and the provers draw their own randomness, so only the anonymity
+ * set is seeded here.
+ */
+struct JoinSplitSetup
+{
+    const Params* params;
+    std::map<uint32_t, std::vector<PublicCoin>> anonymitySets;
+    std::vector<std::pair<PrivateCoin, uint32_t>> Cin;
+    std::vector<size_t> indexes;
+    std::vector<PrivateCoin> Cout;
+    Scalar Vin;
+    uint64_t Vout, fee;
+
+    JoinSplitSetup() : params(Params::get_default()), indexes{0}, Vin(uint64_t(5)), Vout(6), fee(1)
+    {
+        Cin.emplace_back(PrivateCoin(params, 5), 0);
+        Cout.emplace_back(params, 2);
+        Cout.emplace_back(params, 1);
+
+        const AnonymitySet& set = GetAnonymitySet();
+        std::vector<PublicCoin>& coins = anonymitySets[0];
+        coins.assign(set.coins.begin(), set.coins.end());
+        coins[0] = Cin[0].first.getPublicCoin();
+    }
+
+    void Prove(LelantusProof& proof, SchnorrProof& qkSchnorrProof) const
+    {
+        LelantusProver prover(params, LELANTUS_TX_VERSION_4_5);
+        prover.proof(anonymitySets, {}, Vin, Cin, indexes, {}, Vout, Cout, fee, proof, qkSchnorrProof);
+    }
+};
+
+} // namespace
+
+static void SigmaExtendedProve(benchmark::State& state)
+{
+    const AnonymitySet& set = GetAnonymitySet();
+    Scalar x = SeedScalar(7, 0);
+
+    while (state.KeepRunning()) {
+        set.Prove(0, x);
+    }
+}
+
+static void SigmaExtendedVerify(benchmark::State& state)
+{
+    const AnonymitySet& set = GetAnonymitySet();
+    SigmaExtendedVerifier verifier(set.params->get_g(), set.params->get_sigma_h(), set.n, set.m);
+    Scalar x = SeedScalar(7, 0);
+    SigmaExtendedProof proof = set.Prove(0, x);
+
+    while (state.KeepRunning()) {
+        assert(verifier.singleverify(set.coins, x, set.serials[0], proof));
+    }
+}
+
+static void SigmaExtendedBatchVerify(benchmark::State& state)
+{
+    const AnonymitySet& set = GetAnonymitySet();
+    SigmaExtendedVerifier verifier(set.params->get_g(), set.params->get_sigma_h(), set.n, set.m);
+
+    std::vector<Scalar> challenges;
+    std::vector<SigmaExtendedProof> proofs;
+    for (size_t i = 0; i < LELANTUS_BATCH_SIZE; ++i) {
+        challenges.push_back(SeedScalar(7, i));
+        proofs.push_back(set.Prove(i, challenges.back()));
+    }
+    std::vector<size_t> setSizes(LELANTUS_BATCH_SIZE, set.N);
+
+    while (state.KeepRunning()) {
+        assert(verifier.batchverify(set.coins, challenges, set.serials, setSizes, proofs));
+    }
+}
+
+static void RangeProve(benchmark::State& state)
+{
+    RangeSetup setup;
+    std::vector<GroupElement> V;
+
+    while (state.KeepRunning()) {
+        setup.Prove(0, V);
+    }
+}
+
+static void RangeBatchVerify(benchmark::State& state)
+{
+    RangeSetup setup;
+    std::vector<std::vector<GroupElement>> V(LELANTUS_BATCH_SIZE);
+    std::vector<RangeProof> proofs;
+    for (size_t i = 0; i < LELANTUS_BATCH_SIZE; ++i)
+        proofs.push_back(setup.Prove(i, V[i]));
+
+    RangeVerifier verifier(setup.params->get_h1(), setup.params->get_h0(), setup.params->get_g(), setup.g, setup.h, setup.n, LELANTUS_TX_VERSION_4_5);
+
+    while (state.KeepRunning()) {
+        assert(verifier.verify(V, V, proofs));
+    }
+}
+
+static void LelantusProve(benchmark::State& state)
+{
+    JoinSplitSetup setup;
+    LelantusProof proof;
+    SchnorrProof qkSchnorrProof;
+
+    while (state.KeepRunning()) {
+        setup.Prove(proof, qkSchnorrProof);
+    }
+}
+
+static void LelantusVerify(benchmark::State& state)
+{
+    JoinSplitSetup setup;
+    LelantusProof proof;
+    SchnorrProof qkSchnorrProof;
+    setup.Prove(proof, qkSchnorrProof);
+
+    std::vector<Scalar> serials{setup.Cin[0].first.getSerialNumber()};
+    std::vector<uint32_t> groupIds{0};
+    std::vector<PublicCoin> Cout;
+    for (const auto& coin : setup.Cout)
+        Cout.push_back(coin.getPublicCoin());
+
+    LelantusVerifier verifier(setup.params, LELANTUS_TX_VERSION_4_5);
+
+    while (state.KeepRunning()) {
+        assert(verifier.verify(setup.anonymitySets, {}, serials, {}, groupIds, setup.Vin, setup.Vout, setup.fee, Cout, proof, qkSchnorrProof));
+    }
+}
+
+static void SchnorrVerify(benchmark::State& state)
+{
+    const Params* params = Params::get_default();
+    const GroupElement& g = params->get_h1();
+    const GroupElement& h = params->get_h0();
+
+    Scalar P = SeedScalar(8, 0), T = SeedScalar(8, 1);
+    GroupElement y = LelantusPrimitives::commit(g, P, h, T);
+    GroupElement a, b;
+    uint256 seed = SeedHash(8, 2);
+    a.generate(seed.begin());
+    seed = SeedHash(8, 3);
+    b.generate(seed.begin());
+
+    SchnorrProof proof;
+    std::unique_ptr<ChallengeGenerator> challengeGenerator = std::make_unique<ChallengeGeneratorImpl<CHash256>>(1);
+    SchnorrProver(g, h, true).proof(P, T, y, a, b, challengeGenerator, proof);
+
+    SchnorrVerifier verifier(g, h, true);
+
+    while (state.KeepRunning()) {
+        challengeGenerator = std::make_unique<ChallengeGeneratorImpl<CHash256>>(1);
+        assert(verifier.verify(y, a, b, proof, challengeGenerator));
+    }
+}
+
+BENCHMARK(SigmaExtendedProve);
+BENCHMARK(SigmaExtendedVerify);
+BENCHMARK(SigmaExtendedBatchVerify);
+BENCHMARK(RangeProve);
+BENCHMARK(RangeBatchVerify);
+BENCHMARK(LelantusProve);
+BENCHMARK(LelantusVerify);
+BENCHMARK(SchnorrVerify);
@@ -0,0 +1,119 @@
+#include "bench.h"
+
+#include "chainparams.h"
+#include "crypto/Lyra2Z/Lyra2Z.h"
+#include "crypto/MerkleTreeProof/mtp.h"
+#include "crypto/progpow.h"
+#include "crypto/scrypt.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "utilstrencodings.h"
+
+namespace block_bench {
+#include "bench/data/mtp_block.raw.h"
+}
+
+// Proof-of-work functions of every era of the chain: scrypt (genesis), Lyra2Z,
+// MTP and ProgPoW. Inputs are fixed so the numbers are comparable between runs.
+
+/* Difficulty limit the stored MTP block was mined against */
+static const uint256 MTP_BENCH_POW_LIMIT = uint256S("00ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+/* Height of the ProgPoW header; any post-switch height gives the same cost per hash */
+static const uint32_t PROGPOW_BENCH_HEIGHT = 500000;
+
+static CBlockHeader GetMtpBlockHeader()
+{
+    CDataStream stream((const char*)block_bench::mtp_block,
+            (const char*)&block_bench::mtp_block[sizeof(block_bench::mtp_block)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlockHeader header;
+    stream >> header;
+    assert(header.IsMTP() && stream.empty());
+    return header;
+}
+
+static CProgPowHeader GetProgPowBenchHeader()
+{
+    CBlockHeader header = Params().GenesisBlock().GetBlockHeader();
+    header.nTime = Params().GetConsensus().nPPSwitchTime;
+    header.nHeight = PROGPOW_BENCH_HEIGHT;
+    header.nNonce64 = 0x1234567890abcdefULL;
+    return header.GetProgPowHeader();
+}
+
+static void Scrypt(benchmark::State& state)
+{
+    const CBlockHeader& genesis = Params().GenesisBlock();
+    unsigned char nFactor = GetNfactor(genesis.nTime);
+    uint256 hash;
+    while (state.KeepRunning()) {
+        scrypt_N_1_1_256(BEGIN(genesis.nVersion), BEGIN(hash), nFactor);
+    }
+}
+
+static void Lyra2Z(benchmark::State& state)
+{
+    const CBlockHeader& genesis = Params().GenesisBlock();
+    uint256 hash;
+    while (state.KeepRunning()) {
+        lyra2z_hash(BEGIN(genesis.nVersion), BEGIN(hash));
+    }
+}
+
+static void MtpHash(benchmark::State& state)
+{
+    // Searching from the stored header's own inputs finds its nonce again
+    CBlockHeader stored = GetMtpBlockHeader();
+    while (state.KeepRunning()) {
+        CBlockHeader header = stored;
+        header.mtpHashData.reset();
+        uint256 hash = mtp::hash(header, MTP_BENCH_POW_LIMIT);
+        assert(header.nNonce == stored.nNonce && hash == stored.mtpHashValue);
+    }
+}
+
+static void MtpVerify(benchmark::State& state)
+{
+    CBlockHeader header = GetMtpBlockHeader();
+    while (state.KeepRunning()) {
+        assert(mtp::verify(header.nNonce, header, MTP_BENCH_POW_LIMIT));
+    }
+}
+
+static void ProgPowHashLight(benchmark::State& state)
+{
+    CProgPowHeader header = GetProgPowBenchHeader();
+    progpow_hash_full(header, header.mix_hash);
+    while (state.KeepRunning()) {
+        progpow_hash_light(header);
+    }
+}
+
+static void ProgPowHashFull(benchmark::State& state)
+{
+    CProgPowHeader header = GetProgPowBenchHeader();
+    uint256 mix_hash;
+    // The first hash builds the epoch context, keep it out of the measurement
+    progpow_hash_full(header, mix_hash);
+    while (state.KeepRunning()) {
+        progpow_hash_full(header, mix_hash);
+    }
+}
+
+static void EthashEpochContext(benchmark::State& state)
+{
+    const int nEpoch = ethash::get_epoch_number(PROGPOW_BENCH_HEIGHT);
+    while (state.KeepRunning()) {
+        ethash_epoch_context* context = ethash_create_epoch_context(nEpoch);
+        assert(context != nullptr);
+        ethash_destroy_epoch_context(context);
+    }
+}
+
+BENCHMARK(Scrypt);
+BENCHMARK(Lyra2Z);
+BENCHMARK(MtpHash);
+BENCHMARK(MtpVerify);
+BENCHMARK(ProgPowHashLight);
+BENCHMARK(ProgPowHashFull);
+BENCHMARK(EthashEpochContext);
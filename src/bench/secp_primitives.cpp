@@ -0,0 +1,195 @@
+#include "bench.h"
+
+#include <secp256k1/include/GroupElement.h>
+#include <secp256k1/include/MultiExponent.h>
+#include <secp256k1/include/Scalar.h>
+
+using namespace secp_primitives;
+
+/* Number of operands cycled through per iteration, so cheap operations are not dominated by the timer */
+static const size_t OPERANDS = 256;
+/* Largest multiexponentiation measured, the biggest batch a verifier builds */
+static const size_t MAX_MULTIEXP_SIZE = 1 << 17;
+
+volatile size_t hashSink = 0; // volatile, global so not optimized away
+
+static void SeedBuffer(unsigned char seed[32], uint32_t stream, uint32_t i)
+{
+    memset(seed, 0, 32);
+    memcpy(seed, &stream, sizeof(stream));
+    memcpy(seed + sizeof(stream), &i, sizeof(i));
+}
+
+/* Scalars and points derived from fixed seeds, so every run measures the same inputs */
+static std::vector<Scalar> SeededScalars(size_t size, uint32_t stream)
+{
+    std::vector<Scalar> result(size);
+    unsigned char seed[32];
+    for (size_t i = 0; i < size; ++i) {
+        SeedBuffer(seed, stream, i);
+        result[i].memberFromSeed(seed);
+    }
+    return result;
+}
+
+static std::vector<GroupElement> SeededPoints(size_t size, uint32_t stream)
+{
+    std::vector<GroupElement> result(size);
+    unsigned char seed[32];
+    for (size_t i = 0; i < size; ++i) {
+        SeedBuffer(seed, stream, i);
+        result[i].generate(seed);
+    }
+    return result;
+}
+
+static const std::vector<GroupElement>& MultiExpPoints()
+{
+    static const std::vector<GroupElement> points = SeededPoints(MAX_MULTIEXP_SIZE, 1);
+    return points;
+}
+
+static const std::vector<Scalar>& MultiExpScalars()
+{
+    static const std::vector<Scalar> scalars = SeededScalars(MAX_MULTIEXP_SIZE, 2);
+    return scalars;
+}
+
+static void ScalarMul(benchmark::State& state)
+{
+    std::vector<Scalar> a = SeededScalars(OPERANDS, 3);
+    Scalar acc = a[0];
+    while (state.KeepRunning()) {
+        for (const Scalar& s : a)
+            acc *= s;
+    }
+    // results are checked so the work can't be optimized away
+    assert(!acc.isZero());
+}
+
+static void ScalarInverse(benchmark::State& state)
+{
+    std::vector<Scalar> a = SeededScalars(OPERANDS, 3);
+    Scalar acc = a[0];
+    while (state.KeepRunning()) {
+        for (const Scalar& s : a)
+            acc *= s.inverse();
+    }
+    assert(!acc.isZero());
+}
+
+static void GroupElementAdd(benchmark::State& state)
+{
+    std::vector<GroupElement> p = SeededPoints(OPERANDS, 4);
+    GroupElement acc = p[0];
+    while (state.KeepRunning()) {
+        for (const GroupElement& q : p)
+            acc += q;
+    }
+    assert(acc.isMember());
+}
+
+static void GroupElementDouble(benchmark::State& state)
+{
+    GroupElement acc = SeededPoints(1, 4)[0];
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < OPERANDS; ++i)
+            acc.square();
+    }
+    assert(acc.isMember());
+}
+
+static void GroupElementMul(benchmark::State& state)
+{
+    std::vector<GroupElement> p = SeededPoints(OPERANDS, 4);
+    std::vector<Scalar> a = SeededScalars(OPERANDS, 3);
+    GroupElement acc;
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < OPERANDS; ++i)
+            acc += p[i] * a[i];
+    }
+    assert(acc.isMember());
+}
+
+static void GroupElementSerialize(benchmark::State& state)
+{
+    std::vector<GroupElement> p = SeededPoints(OPERANDS, 4);
+    unsigned char buffer[GroupElement::serialize_size];
+    while (state.KeepRunning()) {
+        for (const GroupElement& q : p)
+            q.serialize(buffer);
+    }
+}
+
+static void GroupElementDeserialize(benchmark::State& state)
+{
+    std::vector<GroupElement> p = SeededPoints(OPERANDS, 4);
+    std::vector<unsigned char> buffer(OPERANDS * GroupElement::serialize_size);
+    for (size_t i = 0; i < OPERANDS; ++i)
+        p[i].serialize(&buffer[i * GroupElement::serialize_size]);
+
+    GroupElement q;
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < OPERANDS; ++i)
+            q.deserialize(&buffer[i * GroupElement::serialize_size]);
+    }
+    assert(q == p.back());
+}
+
+static void GroupElementHash(benchmark::State& state)
+{
+    std::vector<GroupElement> p = SeededPoints(OPERANDS, 4);
+    size_t h = 0;
+    while (state.KeepRunning()) {
+        for (const GroupElement& q : p)
+            h ^= q.hash();
+    }
+    hashSink = h;
+}
+
+static void GroupElementEquals(benchmark::State& state)
+{
+    std::vector<GroupElement> p = SeededPoints(OPERANDS, 4);
+    std::vector<GroupElement> q = SeededPoints(OPERANDS, 4);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < OPERANDS; ++i)
+            assert(p[i] == q[i]);
+    }
+}
+
+static void MultiExponentiation(benchmark::State& state, size_t size)
+{
+    std::vector<GroupElement> points(MultiExpPoints().begin(), MultiExpPoints().begin() + size);
+    std::vector<Scalar> scalars(MultiExpScalars().begin(), MultiExpScalars().begin() + size);
+    while (state.KeepRunning()) {
+        MultiExponent mult(points, scalars);
+        mult.get_multiple();
+    }
+}
+
+static void MultiExponent16(benchmark::State& state) { MultiExponentiation(state, 1 << 4); }
+static void MultiExponent64(benchmark::State& state) { MultiExponentiation(state, 1 << 6); }
+static void MultiExponent256(benchmark::State& state) { MultiExponentiation(state, 1 << 8); }
+static void MultiExponent1024(benchmark::State& state) { MultiExponentiation(state, 1 << 10); }
+static void MultiExponent4096(benchmark::State& state) { MultiExponentiation(state, 1 << 12); }
+static void MultiExponent16384(benchmark::State& state) { MultiExponentiation(state, 1 << 14); }
+static void MultiExponent65536(benchmark::State& state) { MultiExponentiation(state, 1 << 16); }
+static void MultiExponent131072(benchmark::State& state) { MultiExponentiation(state, 1 << 17); }
+
+BENCHMARK(ScalarMul);
+BENCHMARK(ScalarInverse);
+BENCHMARK(GroupElementAdd);
+BENCHMARK(GroupElementDouble);
+BENCHMARK(GroupElementMul);
+BENCHMARK(GroupElementSerialize);
+BENCHMARK(GroupElementDeserialize);
+BENCHMARK(GroupElementHash);
+BENCHMARK(GroupElementEquals);
+BENCHMARK(MultiExponent16);
+BENCHMARK(MultiExponent64);
+BENCHMARK(MultiExponent256);
+BENCHMARK(MultiExponent1024);
+BENCHMARK(MultiExponent4096);
+BENCHMARK(MultiExponent16384);
+BENCHMARK(MultiExponent65536);
+BENCHMARK(MultiExponent131072);
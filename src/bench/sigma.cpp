@@ -0,0 +1,112 @@
+#include "bench.h"
+
+#include "hash.h"
+#include "sigma/params.h"
+#include "sigma/sigma_primitives.h"
+#include "sigma/sigmaplus_prover.h"
+#include "sigma/sigmaplus_verifier.h"
+
+namespace {
+
+typedef sigma::SigmaPlusProof<Scalar, GroupElement> SigmaProof;
+
+//! Number of proofs checked together by the batch verification bench
+static const size_t SIGMA_BATCH_SIZE = 8;
+
+//! Derive the i-th member of a fixed-seed stream so every run measures the same inputs
+static uint256 SeedHash(uint32_t seed, uint64_t i)
+{
+    return (CHashWriter(SER_GETHASH, 0) << seed << i).GetHash();
+}
+
+/**
+ * A full anonymity set of the default sigma parameters (N = n^m) in which the
+ * first SIGMA_BATCH_SIZE commitments are zero-serial mints opened by `randoms`.
+ */
+struct SigmaSet
+{
+    const sigma::Params* params;
+    size_t n, m, N;
+    std::vector<GroupElement> commits;
+    std::vector<Scalar> randoms;
+
+    SigmaSet() : params(sigma::Params::get_default())
+    {
+        n = params->get_n();
+        m = params->get_m();
+        N = 1;
+        for (size_t i = 0; i < m; ++i)
+            N *= n;
+
+        commits.resize(N);
+        for (size_t i = 0; i < N; ++i) {
+            uint256 seed = SeedHash(1, i);
+            commits[i].generate(seed.begin());
+        }
+
+        randoms.resize(SIGMA_BATCH_SIZE);
+        for (size_t i = 0; i < SIGMA_BATCH_SIZE; ++i) {
+            uint256 seed = SeedHash(2, i);
+            randoms[i].memberFromSeed(seed.begin());
+            commits[i] = sigma::SigmaPrimitives<Scalar, GroupElement>::commit(
+                params->get_g(), Scalar(uint64_t(0)), params->get_h0(), randoms[i]);
+        }
+    }
+
+    SigmaProof Prove(size_t l) const
+    {
+        sigma::SigmaPlusProver<Scalar, GroupElement> prover(params->get_g(), params->get_h(), n, m);
+        SigmaProof proof(n, m);
+        prover.proof(commits, l, randoms[l], true, proof);
+        return proof;
+    }
+};
+
+static const SigmaSet& GetSigmaSet()
+{
+    static const SigmaSet set;
+    return set;
+}
+
+} // namespace
+
+static void SigmaPlusProve(benchmark::State& state)
+{
+    const SigmaSet& set = GetSigmaSet();
+
+    while (state.KeepRunning()) {
+        set.Prove(0);
+    }
+}
+
+static void SigmaPlusVerify(benchmark::State& state)
+{
+    const SigmaSet& set = GetSigmaSet();
+    sigma::SigmaPlusVerifier<Scalar, GroupElement> verifier(set.params->get_g(), set.params->get_h(), set.n, set.m);
+    SigmaProof proof = set.Prove(0);
+
+    while (state.KeepRunning()) {
+        assert(verifier.verify(set.commits, proof, true));
+    }
+}
+
+static void SigmaPlusBatchVerify(benchmark::State& state)
+{
+    const SigmaSet& set = GetSigmaSet();
+    sigma::SigmaPlusVerifier<Scalar, GroupElement> verifier(set.params->get_g(), set.params->get_h(), set.n, set.m);
+
+    std::vector<SigmaProof> proofs;
+    for (size_t i = 0; i < SIGMA_BATCH_SIZE; ++i)
+        proofs.push_back(set.Prove(i));
+    std::vector<Scalar> serials(SIGMA_BATCH_SIZE, Scalar(uint64_t(0)));
+    std::vector<bool> fPadding(SIGMA_BATCH_SIZE, true);
+    std::vector<size_t> setSizes(SIGMA_BATCH_SIZE, set.N);
+
+    while (state.KeepRunning()) {
+        assert(verifier.batch_verify(set.commits, serials, fPadding, setSizes, proofs));
+    }
+}
+
+BENCHMARK(SigmaPlusProve);
+BENCHMARK(SigmaPlusVerify);
+BENCHMARK(SigmaPlusBatchVerify);
@@ -7,6 +7,7 @@
 #include "bip47/bip47utils.h"
 #include "wallet/wallet.h"
 #include "lelantus.h"
+#include "ctpl.h"
 
 
 namespace bip47 {
@@ -302,6 +303,7 @@ CAccountReceiver & CWallet::createReceivingAccount(std::string const & label)
     uint32_t const accNum = (accReceivers.empty() ? 0 : accReceivers.rbegin()->first + 1);
     accReceivers.emplace(accNum, CAccountReceiver(privkeyReceive, accNum, label));
     CAccountReceiver & acc = accReceivers.rbegin()->second;
+    indexReceiver(acc);
     LogBip47("Created for receiving: pcode: %s, naddr: %s, accNum: %d\n", acc.getMyPcode().toString(), acc.getMyPcode().getNotificationAddress().ToString(), accNum);
     return acc;
 }
@@ -374,4 +376,75 @@ void CWallet::enumerateSenders(std::function<bool(CAccountSender const &)> op) c
     }
 }
 
+CAccountReceiver * CWallet::markAddressUsed(CBitcoinAddress const & address)
+{
+    CAccountReceiver * receiver = const_cast<CAccountReceiver *>(findReceiver(address));
+    if (!receiver)
+        return nullptr;
+    receiver->addressUsed(address);
+    indexReceiver(*receiver);
+    return receiver;
+}
+
+CAccountReceiver const * CWallet::findReceiver(CBitcoinAddress const & address) const
+{
+    CKeyID keyId;
+    if (!address.GetKeyID(keyId))
+        return nullptr;
+    auto const iter = addressIndex.find(keyId);
+    if (iter == addressIndex.end())
+        return nullptr;
+    return getReceivingAccount(iter->second.accountNum);
+}
+
+void CWallet::indexReceiver(CAccountReceiver const & receiver)
+{
+    uint32_t const accountNum = receiver.getAccountNum();
+    std::vector<CKeyID> & indexed = indexedAddresses[accountNum];
+    for (CKeyID const & keyId : indexed)
+        addressIndex.erase(keyId);
+    indexed.clear();
+
+    auto add = [&](CBitcoinAddress const & address, size_t channel) {
+        CKeyID keyId;
+        if (address.GetKeyID(keyId)) {
+            addressIndex[keyId] = CAddressIndexEntry{accountNum, channel};
+            indexed.push_back(keyId);
+        }
+    };
+
+    add(receiver.getMyNotificationAddress(), CAddressIndexEntry::NotificationAddress);
+    CAccountReceiver::PChannelContT const & pchannels = receiver.getPchannels();
+    for (size_t i = 0; i < pchannels.size(); ++i) {
+        for (MyAddrContT::value_type const & addr : pchannels[i].generateMyNextAddresses())
+            add(addr.first, i);
+    }
+}
+
+void CWallet::precomputeLookahead(size_t nThreads)
+{
+    std::vector<CPaymentChannel const *> pchannels;
+    for (std::pair<uint32_t const, CAccountReceiver> const & val : accReceivers) {
+        for (CPaymentChannel const & pchannel : val.second.getPchannels())
+            pchannels.push_back(&pchannel);
+    }
+
+    // Channels cache their addresses independently, so each one can be derived on its own thread
+    nThreads = std::min(nThreads, pchannels.size());
+    if (nThreads > 1) {
+        ctpl::thread_pool pool(nThreads);
+        std::vector<std::future<void>> futures;
+        futures.reserve(pchannels.size());
+        for (CPaymentChannel const * pchannel : pchannels)
+            futures.emplace_back(pool.push([pchannel](int) { pchannel->generateMyNextAddresses(); }));
+        for (std::future<void> & future : futures)
+            future.get();
+    }
+
+    for (std::pair<uint32_t const, CAccountReceiver> const & val : accReceivers)
+        indexReceiver(val.second);
+
+    LogBip47("Indexed %d addresses of %d payment channels\n", addressIndex.size(), pchannels.size());
+}
+
 }
@@ -2,10 +2,12 @@
 #define ZCOIN_BIP47ACCOUNT_H
 
 #include <map>
+#include <unordered_map>
 
 #include "bip47/defs.h"
 #include "bip47/paymentcode.h"
 #include "bip47/paymentchannel.h"
+#include "crypto/common.h"
 #include "key.h"
 #include "pubkey.h"
 
@@ -185,10 +187,42 @@ public:
     void enumerateReceivers(std::function<bool(CAccountReceiver const &)> op) const;
     void enumerateSenders(std::function<bool(CAccountSender &)> op);
     void enumerateSenders(std::function<bool(CAccountSender const &)> op) const;
+
+    /**
+     * Finds the receiving account watching the address with a single index lookup,
+     * marks the address used and moves the lookahead window of its channel.
+     * Returns nullptr if no receiving account watches the address.
+     */
+    CAccountReceiver * markAddressUsed(CBitcoinAddress const & address);
+    CAccountReceiver const * findReceiver(CBitcoinAddress const & address) const;
+
+    /** Updates the address index after channels or used address numbers of the account changed */
+    void indexReceiver(CAccountReceiver const & receiver);
+
+    /** Derives the lookahead windows of all receiving channels on nThreads threads and indexes them */
+    void precomputeLookahead(size_t nThreads);
+
 private:
+    struct CAddressIndexEntry {
+        static constexpr size_t NotificationAddress = size_t(-1);
+
+        uint32_t accountNum;
+        //! position of the channel in the account, NotificationAddress for the account's own notification address
+        size_t channel;
+    };
+
+    struct KeyIdHasher {
+        size_t operator()(CKeyID const & keyId) const { return ReadLE64(keyId.begin()); }
+    };
+
     std::map<uint32_t, CAccountReceiver> accReceivers;
     std::map<uint32_t, CAccountSender> accSenders;
     CExtKey privkeySend, privkeyReceive;
+
+    //! Notification and lookahead addresses of all receiving accounts
+    std::unordered_map<CKeyID, CAddressIndexEntry, KeyIdHasher> addressIndex;
+    //! Indexed addresses by account, to drop them when the account is reindexed
+    std::map<uint32_t, std::vector<CKeyID>> indexedAddresses;
 };
 
 }
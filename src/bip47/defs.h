@@ -13,7 +13,13 @@
 
 namespace bip47
 {
+    //! Default number of unused addresses watched in each receiving payment channel
     static constexpr size_t AddressLookaheadNumber = 10;
+    static constexpr size_t MaxAddressLookaheadNumber = 1000;
+
+    //! Lookahead window of the receiving payment channels, set from -bip47lookahead
+    size_t GetAddressLookahead();
+    void SetAddressLookahead(size_t number);
 
     static constexpr CAmount NotificationTxValue = 0.0001 * COIN;
 
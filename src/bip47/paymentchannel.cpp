@@ -1,3 +1,5 @@
+#include <atomic>
+
 #include "bip47/paymentchannel.h"
 #include "bip47/bip47utils.h"
 #include "bip47/bip47utils.h"
@@ -6,6 +8,20 @@
 
 namespace bip47 {
 
+namespace {
+std::atomic<size_t> addressLookahead(AddressLookaheadNumber);
+}
+
+size_t GetAddressLookahead()
+{
+    return addressLookahead;
+}
+
+void SetAddressLookahead(size_t number)
+{
+    addressLookahead = std::max<size_t>(1, std::min(number, MaxAddressLookaheadNumber));
+}
+
 CPaymentChannel::CPaymentChannel(CPaymentCode const & theirPcode, CExtKey const & myChannelKey, Side side)
 : myChannelKey(myChannelKey), theirPcode(theirPcode), usedAddressCount(0), theirUsedAddressCount(0), side(side)
 {}
@@ -145,8 +161,9 @@ MyAddrContT const & CPaymentChannel::generateMyUsedAddresses() const
 
 MyAddrContT const & CPaymentChannel::generateMyNextAddresses() const
 {
-    if (side == Side::receiver && nextAddresses.size() < AddressLookaheadNumber) {
-        MyAddrContT addrs = generateMySecretAddresses(usedAddressCount + nextAddresses.size(), usedAddressCount + AddressLookaheadNumber);
+    size_t const lookahead = GetAddressLookahead();
+    if (side == Side::receiver && nextAddresses.size() < lookahead) {
+        MyAddrContT addrs = generateMySecretAddresses(usedAddressCount + nextAddresses.size(), usedAddressCount + lookahead);
         std::copy(addrs.begin(), addrs.end(), std::back_inserter(nextAddresses));
     }
     return nextAddresses;
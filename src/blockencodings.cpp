@@ -17,6 +17,8 @@
 
 #define MIN_TRANSACTION_BASE_SIZE (::GetSerializeSize(CTransaction(), SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS))
 
+CompactBlockStats compactBlockStats;
+
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID) :
         nonce(GetRand(std::numeric_limits<uint64_t>::max())),
         shorttxids(block.vtx.size() - 1), prefilledtxn(1), header(block) {
@@ -95,13 +97,17 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
         // Thus: P(max_elements_per_bucket > N) <= S * (1 - cdf(binomial(n=S,p=1/S), N)).
         // If we assume blocks of up to 16000, allowing 12 elements per bucket should
         // only fail once per ~1 million block transfers (per peer and connection).
-        if (shorttxids.bucket_size(shorttxids.bucket(cmpctblock.shorttxids[i])) > 12)
+        if (shorttxids.bucket_size(shorttxids.bucket(cmpctblock.shorttxids[i])) > 12) {
+            compactBlockStats.nFailed++;
             return READ_STATUS_FAILED;
+        }
     }
     // TODO: in the shortid-collision case, we should instead request both transactions
     // which collided. Falling back to full-block-request here is overkill.
-    if (shorttxids.size() != cmpctblock.shorttxids.size())
+    if (shorttxids.size() != cmpctblock.shorttxids.size()) {
+        compactBlockStats.nFailed++;
         return READ_STATUS_FAILED; // Short ID collision
+    }
 
     std::vector<bool> have_txn(txn_available.size());
     {
@@ -133,6 +139,31 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     }
     }
 
+    // Transactions still in the stem phase are not in the mempool yet. Like extra_txn
+    // below, duplicates of mempool transactions must not count as short id collisions
+    if (stempool && mempool_count != shorttxids.size()) {
+    LOCK(stempool->cs);
+    const std::vector<std::pair<uint256, CTxMemPool::txiter> >& vTxHashes = stempool->vTxHashes;
+    for (size_t i = 0; i < vTxHashes.size(); i++) {
+        uint64_t shortid = cmpctblock.GetShortID(vTxHashes[i].first);
+        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
+        if (idit != shorttxids.end()) {
+            if (!have_txn[idit->second]) {
+                txn_available[idit->second] = vTxHashes[i].second->GetSharedTx();
+                have_txn[idit->second]  = true;
+                mempool_count++;
+                stempool_count++;
+            } else if (txn_available[idit->second] &&
+                    txn_available[idit->second]->GetWitnessHash() != vTxHashes[i].first) {
+                txn_available[idit->second].reset();
+                mempool_count--;
+            }
+        }
+        if (mempool_count == shorttxids.size())
+            break;
+    }
+    }
+
     for (size_t i = 0; i < extra_txn.size(); i++) {
         uint64_t shortid = cmpctblock.GetShortID(extra_txn[i].first);
         std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
@@ -204,12 +235,24 @@ ReadStatus PartiallyDownloadedBlock::FillBlock(CBlock& block, const std::vector<
         // but that is expensive, and CheckBlock caches a block's
         // "checked-status" (in the CBlock?). CBlock should be able to
         // check its own merkle root and cache that check.
+        compactBlockStats.nFailed++;
         if (state.CorruptionPossible())
             return READ_STATUS_FAILED; // Possible Short ID collision
         return READ_STATUS_CHECKBLOCK_FAILED;
     }
 
-    LogPrint("cmpctblock", "Successfully reconstructed block %s with %lu txn prefilled, %lu txn from mempool (incl at least %lu from extra pool) and %lu txn requested\n", hash.ToString(), prefilled_count, mempool_count, extra_count, vtx_missing.size());
+    compactBlockStats.nBlocks++;
+    if (!vtx_missing.empty())
+        compactBlockStats.nRoundTrips++;
+    compactBlockStats.nPrefilled += prefilled_count;
+    // collisions are only taken off mempool_count, so the split is approximate
+    if (mempool_count > extra_count + stempool_count)
+        compactBlockStats.nFromMempool += mempool_count - extra_count - stempool_count;
+    compactBlockStats.nFromStempool += stempool_count;
+    compactBlockStats.nFromExtra += extra_count;
+    compactBlockStats.nRequested += vtx_missing.size();
+
+    LogPrint("cmpctblock", "Successfully reconstructed block %s with %lu txn prefilled, %lu txn from mempool (incl at least %lu from extra pool and %lu from stem pool) and %lu txn requested\n", hash.ToString(), prefilled_count, mempool_count, extra_count, stempool_count, vtx_missing.size());
     if (vtx_missing.size() < 5) {
         for (const auto& tx : vtx_missing)
             LogPrint("cmpctblock", "Reconstructed block %s required tx %s\n", hash.ToString(), tx->GetHash().ToString());
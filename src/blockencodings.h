@@ -7,10 +7,25 @@
 
 #include "primitives/block.h"
 
+#include <atomic>
 #include <memory>
 
 class CTxMemPool;
 
+/** Totals over all compact block reconstructions, to measure how often our pools fall short */
+struct CompactBlockStats
+{
+    std::atomic<uint64_t> nBlocks{0};       //!< blocks reconstructed
+    std::atomic<uint64_t> nRoundTrips{0};   //!< blocks that needed a getblocktxn round trip
+    std::atomic<uint64_t> nFailed{0};       //!< reconstructions given up for a full block request
+    std::atomic<uint64_t> nPrefilled{0};    //!< transactions prefilled by the peer
+    std::atomic<uint64_t> nFromMempool{0};  //!< transactions found in the mempool
+    std::atomic<uint64_t> nFromStempool{0}; //!< transactions found in the Dandelion stem pool
+    std::atomic<uint64_t> nFromExtra{0};    //!< transactions found among orphans and replaced transactions
+    std::atomic<uint64_t> nRequested{0};    //!< transactions requested with getblocktxn
+};
+extern CompactBlockStats compactBlockStats;
+
 // Dumb helper to handle CTransaction compression at serialize-time
 struct TransactionCompressor {
 private:
@@ -194,11 +209,12 @@ public:
 class PartiallyDownloadedBlock {
 protected:
     std::vector<CTransactionRef> txn_available;
-    size_t prefilled_count = 0, mempool_count = 0, extra_count = 0;
+    size_t prefilled_count = 0, mempool_count = 0, extra_count = 0, stempool_count = 0;
     CTxMemPool* pool;
+    CTxMemPool* stempool;
 public:
     CBlockHeader header;
-    PartiallyDownloadedBlock(CTxMemPool* poolIn) : pool(poolIn) {}
+    PartiallyDownloadedBlock(CTxMemPool* poolIn, CTxMemPool* stempoolIn = nullptr) : pool(poolIn), stempool(stempoolIn) {}
 
     // extra_txn is a list of extra transactions to look at, in <witness hash, reference> form
     ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn);
@@ -226,6 +226,9 @@ public:
     //! (memory only) Maximum nTime in the chain upto and including this block.
     unsigned int nTimeMax;
 
+    //! (memory only) ProgPoW mix hash was fully verified when the header was accepted (-fullprogpowheaders)
+    bool fProgPowVerified;
+
     //! Public coin values of mints in this block, ordered by serialized value of public coin
     //! Maps <denomination,id> to vector of public coins
     std::map<std::pair<int,int>, std::vector<CBigNum>> mintedPubCoins;
@@ -270,6 +273,7 @@ public:
         nStatus = 0;
         nSequenceId = 0;
         nTimeMax = 0;
+        fProgPowVerified = false;
 
         nVersion       = 0;
         hashMerkleRoot = uint256();
@@ -90,6 +90,13 @@ typedef u_int SOCKET;
 #define THREAD_PRIORITY_ABOVE_NORMAL    (-2)
 #endif
 
+// Linux offers poll() for single sockets and epoll for the socket handler,
+// neither of which is limited to descriptors below FD_SETSIZE
+#if defined(__linux__)
+#define USE_POLL
+#define USE_EPOLL
+#endif
+
 #if HAVE_DECL_STRNLEN == 0
 size_t strnlen( const char *start, size_t max_len);
 #endif // HAVE_DECL_STRNLEN
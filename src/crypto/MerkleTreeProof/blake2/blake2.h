@@ -85,6 +85,16 @@ ARGON2_LOCAL int blake2b_long(void *out, size_t outlen, const void *in, size_t i
 int blake2b_4r_final(blake2b_state *S, void *out, size_t outlen);
 int blake2b_4r_update(blake2b_state *S, const void *in, size_t inlen);
 
+/* Hashes four inputs of inlen bytes with the 4-round compression, same as
+ * blake2b_init/blake2b_4r_update/blake2b_4r_final on each of them. Uses the
+ * vectorized (AVX2, SSE4.1) implementation the CPU supports */
+int blake2b_4r_x4(uint8_t *const out[4], size_t outlen,
+                  const uint8_t *const in[4], size_t inlen);
+/* Restricts blake2b_4r_x4 to the generic code when allow_simd is 0, returns 1
+ * if a vectorized implementation is selected */
+int blake2b_select_implementation(int allow_simd);
+const char *blake2b_implementation(void);
+
 #if defined(__cplusplus)
 }
 #endif
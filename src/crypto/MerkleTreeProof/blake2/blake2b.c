@@ -418,6 +418,252 @@ int blake2b_4r_final(blake2b_state *S, void *out, size_t outlen) {
 }
 
 
+/*
+ * Multi-buffer 4-round BLAKE2b: four inputs of the same length are hashed at
+ * once, one input per vector lane. The vectorized versions are compiled with
+ * target attributes and picked at load time from the CPU features, so the
+ * binary keeps running on CPUs without them.
+ */
+static void blake2b_4r_x4_generic(uint8_t *const out[4], size_t outlen,
+                                  const uint8_t *const in[4], size_t inlen) {
+    unsigned int l;
+    for (l = 0; l < 4; ++l) {
+        blake2b_state S;
+        blake2b_init(&S, outlen);
+        blake2b_4r_update(&S, in[l], inlen);
+        blake2b_4r_final(&S, out[l], outlen);
+    }
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BLAKE2B_X86_SIMD
+
+#include <immintrin.h>
+
+#define BLAKE2B_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define BLAKE2B_TARGET_AVX2 __attribute__((target("avx2")))
+
+/* Copies the next message block of every lane, zero padded when short */
+static BLAKE2_INLINE void blake2b_x4_load_block(uint64_t m[16][4],
+                                                const uint8_t *const *in,
+                                                unsigned int lanes,
+                                                size_t offset, size_t n) {
+    unsigned int i, l;
+    for (l = 0; l < lanes; ++l) {
+        if (n == BLAKE2B_BLOCKBYTES) {
+            for (i = 0; i < 16; ++i) {
+                m[i][l] = load64(in[l] + offset + i * sizeof(uint64_t));
+            }
+        } else {
+            uint8_t block[BLAKE2B_BLOCKBYTES] = {0};
+            if (n > 0) {
+                memcpy(block, in[l] + offset, n);
+            }
+            for (i = 0; i < 16; ++i) {
+                m[i][l] = load64(block + i * sizeof(uint64_t));
+            }
+        }
+    }
+}
+
+static BLAKE2_INLINE void blake2b_x4_store(uint8_t *const *out, size_t outlen,
+                                           const uint64_t h[8][4],
+                                           unsigned int lanes) {
+    unsigned int i, l;
+    for (l = 0; l < lanes; ++l) {
+        uint8_t buffer[BLAKE2B_OUTBYTES];
+        for (i = 0; i < 8; ++i) {
+            store64(buffer + i * sizeof(uint64_t), h[i][l]);
+        }
+        memcpy(out[l], buffer, outlen);
+    }
+}
+
+#define BLAKE2B_X4_G(a, b, c, d, x, y)                                         \
+    do {                                                                       \
+        a = ADD(ADD(a, b), x);                                                 \
+        d = ROT32(XOR(d, a));                                                  \
+        c = ADD(c, d);                                                         \
+        b = ROT24(XOR(b, c));                                                  \
+        a = ADD(ADD(a, b), y);                                                 \
+        d = ROT16(XOR(d, a));                                                  \
+        c = ADD(c, d);                                                         \
+        b = ROT63(XOR(b, c));                                                  \
+    } while ((void)0, 0)
+
+#define BLAKE2B_X4_ROUND(r)                                                    \
+    do {                                                                       \
+        const unsigned int *sigma = blake2b_sigma[r];                          \
+        BLAKE2B_X4_G(v[0], v[4], v[8], v[12], m[sigma[0]], m[sigma[1]]);       \
+        BLAKE2B_X4_G(v[1], v[5], v[9], v[13], m[sigma[2]], m[sigma[3]]);       \
+        BLAKE2B_X4_G(v[2], v[6], v[10], v[14], m[sigma[4]], m[sigma[5]]);      \
+        BLAKE2B_X4_G(v[3], v[7], v[11], v[15], m[sigma[6]], m[sigma[7]]);      \
+        BLAKE2B_X4_G(v[0], v[5], v[10], v[15], m[sigma[8]], m[sigma[9]]);      \
+        BLAKE2B_X4_G(v[1], v[6], v[11], v[12], m[sigma[10]], m[sigma[11]]);    \
+        BLAKE2B_X4_G(v[2], v[7], v[8], v[13], m[sigma[12]], m[sigma[13]]);     \
+        BLAKE2B_X4_G(v[3], v[4], v[9], v[14], m[sigma[14]], m[sigma[15]]);     \
+    } while ((void)0, 0)
+
+/* Compresses all the blocks of every lane, VEC holds one state word of each lane */
+#define BLAKE2B_X4_HASH(VEC, LOAD, STORE, SET1)                                \
+    do {                                                                       \
+        uint64_t words[16][4];                                                 \
+        VEC h[8], v[16], m[16];                                                \
+        size_t offset = 0;                                                     \
+        unsigned int i, r;                                                     \
+        for (i = 0; i < 8; ++i) {                                              \
+            h[i] = SET1(blake2b_IV[i]);                                        \
+        }                                                                      \
+        h[0] = SET1(blake2b_IV[0] ^ (UINT64_C(0x01010000) | outlen));          \
+        do {                                                                   \
+            size_t remaining = inlen - offset;                                 \
+            int last = remaining <= BLAKE2B_BLOCKBYTES;                        \
+            size_t n = last ? remaining : BLAKE2B_BLOCKBYTES;                  \
+            blake2b_x4_load_block(words, in, LANES, offset, n);                \
+            for (i = 0; i < 16; ++i) {                                         \
+                m[i] = LOAD(words[i]);                                         \
+            }                                                                  \
+            offset += n;                                                       \
+            for (i = 0; i < 8; ++i) {                                          \
+                v[i] = h[i];                                                   \
+                v[i + 8] = SET1(blake2b_IV[i]);                                \
+            }                                                                  \
+            v[12] = XOR(v[12], SET1(offset));                                  \
+            if (last) {                                                        \
+                v[14] = XOR(v[14], SET1(~UINT64_C(0)));                        \
+            }                                                                  \
+            for (r = 0; r < 4; ++r) {                                          \
+                BLAKE2B_X4_ROUND(r);                                           \
+            }                                                                  \
+            for (i = 0; i < 8; ++i) {                                          \
+                h[i] = XOR(h[i], XOR(v[i], v[i + 8]));                         \
+            }                                                                  \
+        } while (offset < inlen);                                              \
+        for (i = 0; i < 8; ++i) {                                              \
+            STORE(words[i], h[i]);                                             \
+        }                                                                      \
+        blake2b_x4_store(out, outlen, (const uint64_t(*)[4])words, LANES);    \
+    } while ((void)0, 0)
+
+static BLAKE2B_TARGET_SSE41 void blake2b_4r_x2_sse41(uint8_t *const out[2], size_t outlen,
+                                                     const uint8_t *const in[2], size_t inlen) {
+    const __m128i r16 = _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    const __m128i r24 = _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+
+#define LANES 2
+#define ADD(x, y) _mm_add_epi64((x), (y))
+#define XOR(x, y) _mm_xor_si128((x), (y))
+#define ROT32(x) _mm_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROT24(x) _mm_shuffle_epi8((x), r24)
+#define ROT16(x) _mm_shuffle_epi8((x), r16)
+#define ROT63(x) _mm_xor_si128(_mm_srli_epi64((x), 63), _mm_add_epi64((x), (x)))
+#define LOAD_LANES(p) _mm_loadu_si128((const __m128i *)(p))
+#define STORE_LANES(p, x) _mm_storeu_si128((__m128i *)(p), (x))
+#define SET1(x) _mm_set1_epi64x((long long)(x))
+    BLAKE2B_X4_HASH(__m128i, LOAD_LANES, STORE_LANES, SET1);
+#undef SET1
+#undef STORE_LANES
+#undef LOAD_LANES
+#undef ROT63
+#undef ROT16
+#undef ROT24
+#undef ROT32
+#undef XOR
+#undef ADD
+#undef LANES
+}
+
+static BLAKE2B_TARGET_SSE41 void blake2b_4r_x4_sse41(uint8_t *const out[4], size_t outlen,
+                                                     const uint8_t *const in[4], size_t inlen) {
+    blake2b_4r_x2_sse41(out, outlen, in, inlen);
+    blake2b_4r_x2_sse41(out + 2, outlen, in + 2, inlen);
+}
+
+static BLAKE2B_TARGET_AVX2 void blake2b_4r_x4_avx2(uint8_t *const out[4], size_t outlen,
+                                                   const uint8_t *const in[4], size_t inlen) {
+    const __m256i r16 = _mm256_setr_epi8(
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    const __m256i r24 = _mm256_setr_epi8(
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+
+#define LANES 4
+#define ADD(x, y) _mm256_add_epi64((x), (y))
+#define XOR(x, y) _mm256_xor_si256((x), (y))
+#define ROT32(x) _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROT24(x) _mm256_shuffle_epi8((x), r24)
+#define ROT16(x) _mm256_shuffle_epi8((x), r16)
+#define ROT63(x) _mm256_xor_si256(_mm256_srli_epi64((x), 63), _mm256_add_epi64((x), (x)))
+#define LOAD_LANES(p) _mm256_loadu_si256((const __m256i *)(p))
+#define STORE_LANES(p, x) _mm256_storeu_si256((__m256i *)(p), (x))
+#define SET1(x) _mm256_set1_epi64x((long long)(x))
+    BLAKE2B_X4_HASH(__m256i, LOAD_LANES, STORE_LANES, SET1);
+#undef SET1
+#undef STORE_LANES
+#undef LOAD_LANES
+#undef ROT63
+#undef ROT16
+#undef ROT24
+#undef ROT32
+#undef XOR
+#undef ADD
+#undef LANES
+}
+
+#undef BLAKE2B_X4_HASH
+#undef BLAKE2B_X4_ROUND
+#undef BLAKE2B_X4_G
+#endif /* x86 */
+
+typedef void (*blake2b_4r_x4_fn)(uint8_t *const out[4], size_t outlen,
+                                 const uint8_t *const in[4], size_t inlen);
+
+static blake2b_4r_x4_fn blake2b_4r_x4_impl = blake2b_4r_x4_generic;
+static const char *blake2b_x4_impl_name = "generic";
+
+int blake2b_select_implementation(int allow_simd) {
+    blake2b_4r_x4_impl = blake2b_4r_x4_generic;
+    blake2b_x4_impl_name = "generic";
+#if defined(BLAKE2B_X86_SIMD)
+    if (allow_simd) {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            blake2b_4r_x4_impl = blake2b_4r_x4_avx2;
+            blake2b_x4_impl_name = "avx2";
+            return 1;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            blake2b_4r_x4_impl = blake2b_4r_x4_sse41;
+            blake2b_x4_impl_name = "sse4.1";
+            return 1;
+        }
+    }
+#else
+    (void)allow_simd;
+#endif
+    return 0;
+}
+
+const char *blake2b_implementation(void) {
+    return blake2b_x4_impl_name;
+}
+
+#if defined(BLAKE2B_X86_SIMD)
+__attribute__((constructor)) static void blake2b_init_implementation(void) {
+    blake2b_select_implementation(1);
+}
+#endif
+
+int blake2b_4r_x4(uint8_t *const out[4], size_t outlen,
+                  const uint8_t *const in[4], size_t inlen) {
+    if ((outlen == 0) || (outlen > BLAKE2B_OUTBYTES)) {
+        return -1;
+    }
+    blake2b_4r_x4_impl(out, outlen, in, inlen);
+    return 0;
+}
+
 int blake2b(void *out, size_t outlen, const void *in, size_t inlen,
             const void *key, size_t keylen) {
     blake2b_state S;
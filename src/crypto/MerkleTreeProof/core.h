@@ -226,4 +226,12 @@ void fill_segment_mtp(const argon2_instance_t *instance,
  */
 int fill_memory_blocks_mtp(argon2_instance_t *instance, argon2_context *context);
 
+/*
+ * AVX2 version of fill_block_mtp_ref, defined in opt.c. Returns 0 without
+ * touching next_block when the build or the CPU does not support it.
+ */
+int fill_block_mtp_avx2(const block *prev_block, const block *ref_block,
+                        block *next_block, int with_xor, uint32_t block_index,
+                        const uint8_t *hash_zero);
+
 #endif
@@ -58,9 +58,7 @@ MerkleTree::Buffer MerkleTree::hash(const Buffer& data)
 {
     blake2b_state state;
     blake2b_init(&state, MERKLE_TREE_ELEMENT_SIZE_B);
-    for (Buffer::const_iterator it = data.begin(); it != data.end(); ++it) {
-        blake2b_4r_update(&state, &(*it), sizeof(*it));
-    }
+    blake2b_4r_update(&state, data.data(), data.size());
     uint8_t digest[MERKLE_TREE_ELEMENT_SIZE_B];
     blake2b_4r_final(&state, digest, sizeof(digest));
     return Buffer(digest, digest + sizeof(digest));
@@ -69,16 +67,15 @@ MerkleTree::Buffer MerkleTree::hash(const Buffer& data)
 MerkleTree::Buffer MerkleTree::combinedHash(const Buffer& first,
         const Buffer& second, bool preserveOrder)
 {
-    Buffer buffer;
-    buffer.reserve(first.size() + second.size());
-    if (preserveOrder || (first > second)) {
-        std::copy(first.begin(), first.end(), std::back_inserter(buffer));
-        std::copy(second.begin(), second.end(), std::back_inserter(buffer));
-    } else {
-        std::copy(second.begin(), second.end(), std::back_inserter(buffer));
-        std::copy(first.begin(), first.end(), std::back_inserter(buffer));
-    }
-    return hash(buffer);
+    const Buffer& left = (preserveOrder || (first > second)) ? first : second;
+    const Buffer& right = (&left == &first) ? second : first;
+    blake2b_state state;
+    blake2b_init(&state, MERKLE_TREE_ELEMENT_SIZE_B);
+    blake2b_4r_update(&state, left.data(), left.size());
+    blake2b_4r_update(&state, right.data(), right.size());
+    uint8_t digest[MERKLE_TREE_ELEMENT_SIZE_B];
+    blake2b_4r_final(&state, digest, sizeof(digest));
+    return Buffer(digest, digest + sizeof(digest));
 }
 
 MerkleTree::Buffer MerkleTree::merkleRoot(const Elements& elements,
@@ -192,6 +189,77 @@ bool MerkleTree::checkProofOrdered(const Elements& proof,
     return tempHash == root;
 }
 
+size_t MerkleTree::checkProofsOrdered(const OrderedProof* proofs,
+        size_t count, const Buffer& root)
+{
+    const size_t width = 4; // inputs of blake2b_4r_x4
+    const size_t size = MERKLE_TREE_ELEMENT_SIZE_B;
+
+    size_t first = 0;
+    while (first < count) {
+        const size_t depth = proofs[first].depth;
+        size_t lanes = 1;
+        while ((lanes < width) && ((first + lanes) < count)
+                && (proofs[first + lanes].depth == depth)) {
+            ++lanes;
+        }
+
+        // Same steps as checkProofOrdered(), one lane per proof; unused
+        // lanes hash the first input again into a scratch digest
+        uint8_t hashes[width][size];
+        uint8_t inputs[width][2 * size];
+        uint8_t scratch[size];
+        size_t indexes[width];
+        uint8_t* out[width];
+        const uint8_t* in[width];
+        for (size_t l = 0; l < width; ++l) {
+            out[l] = (l < lanes) ? hashes[l] : scratch;
+            in[l] = inputs[(l < lanes) ? l : 0];
+        }
+        for (size_t l = 0; l < lanes; ++l) {
+            std::copy(proofs[first + l].element,
+                    proofs[first + l].element + size, hashes[l]);
+            indexes[l] = proofs[first + l].index - 1; // starts at 1
+        }
+
+        for (size_t i = 0; i < depth; ++i) {
+            size_t remaining = depth - i;
+            for (size_t l = 0; l < lanes; ++l) {
+                size_t& index = indexes[l];
+                while (((index & 1) == 0) && (index >= (1u << remaining))) {
+                    index = index / 2;
+                }
+                const uint8_t* sibling = proofs[first + l].proof + i * size;
+                if (index & 1) {
+                    std::copy(sibling, sibling + size, inputs[l]);
+                    std::copy(hashes[l], hashes[l] + size, inputs[l] + size);
+                } else {
+                    std::copy(hashes[l], hashes[l] + size, inputs[l]);
+                    std::copy(sibling, sibling + size, inputs[l] + size);
+                }
+                index = index / 2;
+            }
+            if (lanes == 1) {
+                blake2b_state state;
+                blake2b_init(&state, size);
+                blake2b_4r_update(&state, inputs[0], 2 * size);
+                blake2b_4r_final(&state, hashes[0], size);
+            } else {
+                blake2b_4r_x4(out, size, in, 2 * size);
+            }
+        }
+
+        for (size_t l = 0; l < lanes; ++l) {
+            if ((root.size() != size)
+                    || !std::equal(hashes[l], hashes[l] + size, root.begin())) {
+                return first + l;
+            }
+        }
+        first += lanes;
+    }
+    return count;
+}
+
 void MerkleTree::getLayers()
 {
     layers_.clear();
@@ -199,6 +199,35 @@ public :
     static bool checkProofOrdered(const Elements& proof, const Buffer& root,
             const Buffer& element, size_t index);
 
+    /** Proof for an element of a Merkle Tree with order preserved
+     *
+     * \see checkProofOrdered
+     */
+    struct OrderedProof
+    {
+        const uint8_t* proof;   /**< Hashes of the proof, back to back */
+        size_t depth;           /**< Number of hashes in the proof */
+        const uint8_t* element; /**< Element for which the proof is checked */
+        size_t index;           /**< Index of the element, starting at 1 */
+    };
+
+    /** Check several proofs in a Merkle Tree with order preserved
+     *
+     * This function gives the same answer as calling `checkProofOrdered()`
+     * on each proof, but reads the hashes in place and hashes the layers of
+     * up to four proofs of the same length together. All the hashes are
+     * `MERKLE_TREE_ELEMENT_SIZE_B` bytes long.
+     *
+     * \param proofs [in] Proofs to check
+     * \param count  [in] Number of proofs
+     * \param root   [in] Root hash of the Merkle Tree
+     *
+     * \return The position of the first invalid proof, or `count` if all the
+     *         proofs are valid
+     */
+    static size_t checkProofsOrdered(const OrderedProof* proofs, size_t count,
+            const Buffer& root);
+
 private :
     /** Layers data structure
      *
@@ -1,6 +1,7 @@
 #include "mtp.h"
 #include "util.h"
 #include "arith_uint256.h"
+#include "ctpl.h"
 
 extern "C" {
 #include "blake2/blake2.h"
@@ -16,6 +17,10 @@ extern "C" {
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <mutex>
 #include "merkle-tree.hpp"
 #include "primitives/block.h"
 #include "streams.h"
@@ -39,6 +44,8 @@ const int8_t L = MTP_L;
 const unsigned T_COST = 1;
 const unsigned M_COST = 1024 * 1024 * 4;
 const unsigned LANES = 4;
+//! Threads checking the Merkle paths of a proof, including the caller
+const int MAX_VERIFY_THREADS = 4;
 
 void StoreBlock(void *output, const block *src)
 {
@@ -189,6 +196,109 @@ void compute_blake2b(const block& input,
     clear_internal_memory(tmp_block_bytes, ARGON2_BLOCK_SIZE);
 }
 
+/** Block opened by a MTP proof and the Merkle path proving it */
+struct Opening
+{
+    const block* opened;
+    const uint8_t* proof; //!< Hashes of the Merkle path, in the proof arena
+    size_t depth; //!< Number of hashes in the Merkle path
+    size_t index; //!< Position of the block in the Merkle tree, starting at 1
+    const char* name; //!< Name of the block in the error message
+};
+
+/** Hash the opened blocks and check their Merkle paths
+ *
+ * The blocks are hashed four at a time, and so are the paths.
+ *
+ * \return Position of the first invalid opening, or `count` if all of them
+ *         are valid
+ */
+size_t CheckOpenings(const Opening* openings, size_t count,
+        const MerkleTree::Buffer& root)
+{
+    std::vector<MerkleTree::OrderedProof> proofs(count);
+    std::vector<uint8_t> digests((count + 3) * MERKLE_TREE_ELEMENT_SIZE_B);
+    for (size_t i = 0; i < count; i += 4) {
+        uint8_t* out[4];
+        const uint8_t* in[4];
+#if !defined(NATIVE_LITTLE_ENDIAN)
+        uint8_t bytes[4][ARGON2_BLOCK_SIZE];
+#endif
+        for (size_t l = 0; l < 4; ++l) {
+            const block* opened = openings[std::min(i + l, count - 1)].opened;
+#if defined(NATIVE_LITTLE_ENDIAN)
+            // The blocks are hashed in place, they are already in byte order
+            in[l] = reinterpret_cast<const uint8_t*>(opened->v);
+#else
+            StoreBlock(bytes[l], opened);
+            in[l] = bytes[l];
+#endif
+            out[l] = &digests[(i + l) * MERKLE_TREE_ELEMENT_SIZE_B];
+        }
+        blake2b_4r_x4(out, MERKLE_TREE_ELEMENT_SIZE_B, in, ARGON2_BLOCK_SIZE);
+        for (size_t l = 0; (l < 4) && ((i + l) < count); ++l) {
+            MerkleTree::OrderedProof& proof = proofs[i + l];
+            proof.proof = openings[i + l].proof;
+            proof.depth = openings[i + l].depth;
+            proof.element = out[l];
+            proof.index = openings[i + l].index;
+        }
+    }
+    return MerkleTree::checkProofsOrdered(proofs.data(), count, root);
+}
+
+/** Workers shared by all the verifications, null on a single core */
+ctpl::thread_pool* GetVerifyPool()
+{
+    static std::once_flag once;
+    static std::unique_ptr<ctpl::thread_pool> pool;
+    std::call_once(once, []() {
+        int threads = std::min(GetNumCores(), MAX_VERIFY_THREADS) - 1;
+        if (threads > 0) {
+            pool.reset(new ctpl::thread_pool(threads));
+            RenameThreadPool(*pool, "firo-mtpverify");
+        }
+    });
+    return pool.get();
+}
+
+/** Check all the openings, in chunks spread over the verification workers
+ *
+ * \return Position of the first invalid opening, or `openings.size()` if all
+ *         of them are valid
+ */
+size_t CheckOpeningsParallel(const std::vector<Opening>& openings,
+        const MerkleTree::Buffer& root)
+{
+    const size_t count = openings.size();
+    ctpl::thread_pool* pool = GetVerifyPool();
+    size_t chunks = pool ? (pool->size() + 1) : 1;
+    // Keep the chunks a multiple of the four hashing lanes
+    size_t chunkSize = ((count + chunks - 1) / chunks + 3) & ~size_t(3);
+
+    std::vector<std::future<size_t>> results;
+    for (size_t begin = chunkSize; begin < count; begin += chunkSize) {
+        size_t size = std::min(chunkSize, count - begin);
+        results.push_back(pool->push([&openings, &root, begin, size](int) {
+            return begin + CheckOpenings(&openings[begin], size, root);
+        }));
+    }
+
+    size_t size = std::min(chunkSize, count);
+    size_t failed = CheckOpenings(openings.data(), size, root);
+    if (failed == size) {
+        failed = count;
+    }
+    for (size_t i = 0; i < results.size(); ++i) {
+        size_t end = std::min(chunkSize * (i + 2), count);
+        size_t result = results[i].get();
+        if (result < end) {
+            failed = std::min(failed, result);
+        }
+    }
+    return failed;
+}
+
 struct TargetHelper
 {
     bool m_negative;
@@ -209,17 +319,21 @@ namespace impl
 bool mtp_verify(const char* input, const uint32_t target,
         const uint8_t hash_root_mtp[16], uint32_t nonce,
         const uint64_t block_mtp[MTP_L*2][128],
-        const std::deque<std::vector<uint8_t>> proof_mtp[MTP_L*3],
+        const ProofArena& proof_mtp,
         uint256 pow_limit,
         uint256 *mtpHashValue)
 {
     MerkleTree::Buffer const root(&hash_root_mtp[0], &hash_root_mtp[16]);
-    block blocks[L * 2];
-    for(int i = 0; i < (L * 2); ++i) {
-        std::memcpy(blocks[i].v, block_mtp[i],
-                sizeof(uint64_t) * ARGON2_QWORDS_IN_BLOCK);
+    if (proof_mtp.size() != ProofArena::PROOFS) {
+        LogPrintf("error : missing MTP proofs\n");
+        return false;
     }
 
+    // The blocks are used in place, without copying them from the header
+    static_assert(sizeof(block) == sizeof(block_mtp[0]),
+            "block_mtp rows must be Argon2 blocks");
+    const block* blocks = reinterpret_cast<const block*>(block_mtp);
+
 #define TEST_OUTLEN 32
 #define TEST_PWDLEN 80
 #define TEST_SALTLEN 80
@@ -295,32 +409,30 @@ bool mtp_verify(const char* input, const uint32_t target,
     initial_hash(h0, &context_verify, instance.type);
     
     // step 8
+    // The y chain is computed first, the Merkle paths of the opened blocks
+    // only depend on it and are checked together afterwards
+    static_assert((M_COST & (M_COST - 1)) == 0,
+            "ij is taken from the low bits of y");
+    uint32_t memory_blocks_2 = M_COST;
+    if (memory_blocks_2 < (2 * ARGON2_SYNC_POINTS * LANES)) {
+        memory_blocks_2 = 2 * ARGON2_SYNC_POINTS * LANES;
+    }
+    uint32_t segment_length_2 = memory_blocks_2 / (LANES * ARGON2_SYNC_POINTS);
+    uint32_t lane_length = segment_length_2 * ARGON2_SYNC_POINTS;
+
+    std::vector<block> blocks_ij(L);
+    std::vector<Opening> openings;
+    openings.reserve(L * 3);
     for (uint32_t j = 1; j <= L; ++j) {
         // compute ij
-        std::string s = "0x" + y[j - 1].GetHex();
-        boost::multiprecision::uint256_t t(s);
-        uint32_t ij = numeric_cast<uint32_t>(t % M_COST);
+        uint32_t ij = static_cast<uint32_t>(
+                UintToArith256(y[j - 1]).GetLow64() % M_COST);
 
-        // retrieve x[ij-1] and x[phi(i)] from proof
-        block prev_block, ref_block, t_prev_block, t_ref_block;
-        std::memcpy(t_prev_block.v, block_mtp[(j * 2) - 2],
-                sizeof(uint64_t) * ARGON2_QWORDS_IN_BLOCK);
-        std::memcpy(t_ref_block.v, block_mtp[j*2 - 1],
-                sizeof(uint64_t) * ARGON2_QWORDS_IN_BLOCK);
-        copy_block(&prev_block , &t_prev_block);
-        copy_block(&ref_block , &t_ref_block);
-        clear_internal_memory(t_prev_block.v, ARGON2_BLOCK_SIZE);
-        clear_internal_memory(t_ref_block.v, ARGON2_BLOCK_SIZE);
+        // x[ij-1] and x[phi(i)] come from the proof
+        const block& prev_block = blocks[(j * 2) - 2];
+        const block& ref_block = blocks[(j * 2) - 1];
 
         //prev_index
-        //compute
-        uint32_t memory_blocks_2 = M_COST;
-        if (memory_blocks_2 < (2 * ARGON2_SYNC_POINTS * LANES)) {
-            memory_blocks_2 = 2 * ARGON2_SYNC_POINTS * LANES;
-        }
-
-        uint32_t segment_length_2 = memory_blocks_2 / (LANES * ARGON2_SYNC_POINTS);
-        uint32_t lane_length = segment_length_2 * ARGON2_SYNC_POINTS;
         uint32_t ij_prev = 0;
         if ((ij % lane_length) == 0) {
             ij_prev = ij + lane_length - 1;
@@ -331,17 +443,6 @@ bool mtp_verify(const char* input, const uint32_t target,
             ij_prev = ij - 1;
         }
 
-        //hash[prev_index]
-        uint8_t digest_prev[MERKLE_TREE_ELEMENT_SIZE_B];
-        compute_blake2b(prev_block, digest_prev);
-        MerkleTree::Buffer hash_prev(digest_prev,
-                digest_prev + sizeof(digest_prev));
-        if (!MerkleTree::checkProofOrdered(proof_mtp[(j * 3) - 2],
-                    root, hash_prev, ij_prev + 1)) {
-            LogPrintf("error : checkProofOrdered in x[ij_prev]\n");
-            return false;
-        }
-
         //compute ref_index
         uint64_t prev_block_opening = prev_block.v[0];
         uint32_t ref_lane = static_cast<uint32_t>((prev_block_opening >> 32) % LANES);
@@ -364,46 +465,38 @@ bool mtp_verify(const char* input, const uint32_t target,
 
         uint32_t computed_ref_block = (lane_length * ref_lane) + ref_index;
 
-        uint8_t digest_ref[MERKLE_TREE_ELEMENT_SIZE_B];
-        compute_blake2b(ref_block, digest_ref);
-        MerkleTree::Buffer hash_ref(digest_ref, digest_ref + sizeof(digest_ref));
-        if (!MerkleTree::checkProofOrdered(proof_mtp[(j * 3) - 1],
-                    root, hash_ref, computed_ref_block + 1)) {
-            LogPrintf("error : checkProofOrdered in x[ij_ref]\n");
-            return false;
-        }
-
         // compute x[ij]
-        block block_ij;
-        fill_block_mtp(&blocks[(j * 2) - 2], &blocks[(j * 2) - 1],
-                &block_ij, 0, computed_ref_block, h0);
-
-        // verify opening
-        // hash x[ij]
-        uint8_t digest_ij[MERKLE_TREE_ELEMENT_SIZE_B];
-        compute_blake2b(block_ij, digest_ij);
-        MerkleTree::Buffer hash_ij(digest_ij, digest_ij + sizeof(digest_ij));
-
-        if (!MerkleTree::checkProofOrdered(proof_mtp[(j * 3) - 3], root,
-                    hash_ij, ij + 1)) {
-            LogPrintf("error : checkProofOrdered in x[ij]\n");
-            return false;
-        }
+        block& block_ij = blocks_ij[j - 1];
+        fill_block_mtp(&prev_block, &ref_block, &block_ij, 0,
+                computed_ref_block, h0);
+
+        openings.push_back({&prev_block, proof_mtp.data((j * 3) - 2),
+                proof_mtp.size((j * 3) - 2), ij_prev + 1, "ij_prev"});
+        openings.push_back({&ref_block, proof_mtp.data((j * 3) - 1),
+                proof_mtp.size((j * 3) - 1), computed_ref_block + 1, "ij_ref"});
+        openings.push_back({&block_ij, proof_mtp.data((j * 3) - 3),
+                proof_mtp.size((j * 3) - 3), ij + 1, "ij"});
 
         // compute y(j)
-        block blockhash;
-        copy_block(&blockhash, &block_ij);
         uint8_t blockhash_bytes[ARGON2_BLOCK_SIZE];
-        StoreBlock(&blockhash_bytes, &blockhash);
+        StoreBlock(&blockhash_bytes, &block_ij);
         blake2b_state ctx_yj;
         blake2b_init(&ctx_yj, 32);
         blake2b_update(&ctx_yj, &y[j - 1], 32);
         blake2b_update(&ctx_yj, blockhash_bytes, ARGON2_BLOCK_SIZE);
         blake2b_final(&ctx_yj, &y[j], 32);
-        clear_internal_memory(block_ij.v, ARGON2_BLOCK_SIZE);
-        clear_internal_memory(blockhash.v, ARGON2_BLOCK_SIZE);
         clear_internal_memory(blockhash_bytes, ARGON2_BLOCK_SIZE);
-    }    
+    }
+
+    // verify openings
+    size_t failed = CheckOpeningsParallel(openings, root);
+    for (uint32_t j = 0; j < L; ++j) {
+        clear_internal_memory(blocks_ij[j].v, ARGON2_BLOCK_SIZE);
+    }
+    if (failed < openings.size()) {
+        LogPrintf("error : checkProofOrdered in x[%s]\n", openings[failed].name);
+        return false;
+    }
 
     // step 9
     bool negative;
@@ -411,10 +504,6 @@ bool mtp_verify(const char* input, const uint32_t target,
     arith_uint256 bn_target;
     bn_target.SetCompact(target, &negative, &overflow); // diff = 1
 
-    for (int i = 0; i < (L * 2); ++i) {
-        clear_internal_memory(blocks[i].v, ARGON2_BLOCK_SIZE);
-    }
-
     if (mtpHashValue)
         *mtpHashValue = y[L];
 
@@ -430,7 +519,7 @@ namespace {
 
 bool mtp_hash1(const char* input, uint32_t target, uint8_t hash_root_mtp[16],
         unsigned int& nonce, uint64_t block_mtp[MTP_L*2][128],
-        std::deque<std::vector<uint8_t>> proof_mtp[MTP_L*3], uint256 pow_limit,
+        ProofArena& proof_mtp, uint256 pow_limit,
         uint256& output)
 {
 #define TEST_OUTLEN 32
@@ -618,8 +707,10 @@ bool mtp_hash1(const char* input, uint32_t target, uint8_t hash_root_mtp[16],
         std::memcpy(block_mtp[i], &blocks[i],
                 sizeof(uint64_t) * ARGON2_QWORDS_IN_BLOCK);
     }
+    proof_mtp.clear();
+    proof_mtp.reserve();
     for (int i = 0; i < L * 3; ++i) {
-        proof_mtp[i] = proof_blocks[i];
+        proof_mtp.push_back(proof_blocks[i]);
     }
     std::memcpy(&output, &y[L], sizeof(uint256));
 
@@ -639,7 +730,7 @@ bool mtp_hash1(const char* input, uint32_t target, uint8_t hash_root_mtp[16],
 
 void mtp_hash(const char* input, uint32_t target, uint8_t hash_root_mtp[16],
         unsigned int& nonce, uint64_t block_mtp[MTP_L*2][128],
-        std::deque<std::vector<uint8_t>> proof_mtp[MTP_L*3], uint256 pow_limit,
+        ProofArena& proof_mtp, uint256 pow_limit,
         uint256& output)
 {
     bool done = false;
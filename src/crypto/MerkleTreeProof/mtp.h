@@ -5,6 +5,8 @@ extern "C" {
 #include <inttypes.h>
 }
 #include "uint256.h"
+#include <cassert>
+#include <cstring>
 #include <deque>
 #include <vector>
 
@@ -16,6 +18,77 @@ namespace mtp
 /** L parameter for the MTP hash */
 constexpr int8_t MTP_L = 64;
 
+/** Size of a hash in the Merkle proofs, 128 bits of blake2b */
+constexpr size_t MTP_PROOF_HASH_SIZE = 16;
+
+/** Merkle proofs of the blocks opened by a MTP hash
+ *
+ * The MTP_L*3 proofs are stored back to back in a single buffer, so that a
+ * block needs one allocation for all of them. Proof `i` is made of `size(i)`
+ * hashes of MTP_PROOF_HASH_SIZE bytes starting at `data(i)`, from the lowest
+ * layer of the Merkle tree up to the root.
+ */
+class ProofArena
+{
+public:
+    /** Number of proofs of a MTP hash */
+    static constexpr size_t PROOFS = MTP_L * 3;
+    /** Hashes reserved per proof, enough for the default memory cost */
+    static constexpr size_t EXPECTED_DEPTH = 22;
+
+    ProofArena() : count(0)
+    {
+        offsets[0] = 0;
+    }
+
+    /** Number of proofs added so far */
+    size_t size() const { return count; }
+
+    /** Number of hashes in proof `i` */
+    size_t size(size_t i) const { return offsets[i + 1] - offsets[i]; }
+
+    /** First hash of proof `i` */
+    const uint8_t* data(size_t i) const { return hashes.data() + offsets[i] * MTP_PROOF_HASH_SIZE; }
+    uint8_t* data(size_t i) { return hashes.data() + offsets[i] * MTP_PROOF_HASH_SIZE; }
+
+    void clear()
+    {
+        hashes.clear();
+        count = 0;
+    }
+
+    /** Make room for all the proofs of a MTP hash */
+    void reserve() { hashes.reserve(PROOFS * EXPECTED_DEPTH * MTP_PROOF_HASH_SIZE); }
+
+    /** Add the next proof, made of `n` hashes
+     *
+     * \return Where to write the hashes of the proof
+     */
+    uint8_t* push_back(size_t n)
+    {
+        assert(count < PROOFS && n < 256);
+        hashes.resize(hashes.size() + n * MTP_PROOF_HASH_SIZE);
+        offsets[count + 1] = offsets[count] + n;
+        return data(count++);
+    }
+
+    /** Add the next proof from the hashes of a Merkle tree proof */
+    void push_back(const std::deque<std::vector<uint8_t>>& proof)
+    {
+        uint8_t* out = push_back(proof.size());
+        for (const std::vector<uint8_t>& hash: proof) {
+            assert(hash.size() == MTP_PROOF_HASH_SIZE);
+            memcpy(out, hash.data(), MTP_PROOF_HASH_SIZE);
+            out += MTP_PROOF_HASH_SIZE;
+        }
+    }
+
+private:
+    std::vector<uint8_t> hashes;
+    uint32_t offsets[PROOFS + 1]; //!< Start of each proof, in hashes
+    size_t count;
+};
+
 /** Solve the hash problem
  *
  * This function will try different nonce until it finds one such that the
@@ -53,7 +126,8 @@ namespace impl
  * \param nonce         [out] Found nonce that satisfied the `target`
  * \param block_mtp     [out] Merkle tree leaves against which the hash has
  *                            been computed: 72*2 leaves of 1KiB each
- * \param proof_mtp     [out] Merkle proofs for every element in `block_mtp`
+ * \param proof_mtp     [out] Merkle proofs for every element in `block_mtp`,
+ *                            replaces the content of the arena
  * \param pow_limit     [in]  Network limit (hash must be less than that)
  * \param output        [out] Resulting hash value for the given `nonce`
  */
@@ -62,7 +136,7 @@ void mtp_hash(const char* input,
         uint8_t hash_root_mtp[16],
         unsigned int& nonce,
         uint64_t block_mtp[MTP_L*2][128],
-        std::deque<std::vector<uint8_t>> proof_mtp[MTP_L*3],
+        ProofArena& proof_mtp,
         uint256 pow_limit,
         uint256& output);
 
@@ -75,7 +149,7 @@ void mtp_hash(const char* input,
  * \param target        [in] Target difficulty to achieve
  * \param hash_root_mtp [in] Root hash of the merkle tree
  * \param nonce         [in] Nonce to verify
- * \param block_mtp     [in] Data used to compute hash values
+ * \param block_mtp     [in] Data used to compute hash values, read in place
  * \param proof_mtp     [in] Merkle proofs for every element in `block_mtp`;
  * \param pow_limit     [in] Network limit (hash must be less than that)
  *
@@ -86,7 +160,7 @@ bool mtp_verify(const char* input,
         const uint8_t hash_root_mtp[16],
         const uint32_t nonce,
         const uint64_t block_mtp[MTP_L*2][128],
-        const std::deque<std::vector<uint8_t>> proof_mtp[MTP_L*3],
+        const ProofArena& proof_mtp,
         uint256 pow_limit,
         uint256 *mtpHashValue=nullptr);
 }
@@ -0,0 +1,111 @@
+/*
+ * Argon2 source code package - AVX2 block function for MTP
+ *
+ * Copyright 2015
+ * Daniel Dinu, Dmitry Khovratovich, Jean-Philippe Aumasson, and Samuel Neves
+ *
+ * You may use this work under the terms of a Creative Commons CC0 1.0
+ * License/Waiver or the Apache Public License 2.0, at your option. The terms of
+ * these licenses can be found at:
+ *
+ * - CC0 1.0 Universal : http://creativecommons.org/publicdomain/zero/1.0
+ * - Apache 2.0        : http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * You should have received a copy of both of these licenses along with this
+ * software. If not, they may be obtained at the above URLs.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "argon2.h"
+#include "core.h"
+
+/*
+ * The AVX2 code is compiled for that target only, so the binary still runs
+ * on older CPUs; fill_block_mtp picks it at runtime. The target pragma also
+ * defines __AVX2__, which selects the AVX2 rounds of blamka-round-opt.h. A
+ * build that already enables AVX-512 gets other rounds from that header and
+ * keeps the reference code.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__AVX512F__) && \
+    (defined(__x86_64__) || defined(__i386__))
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+#include "blake2/blamka-round-opt.h"
+
+static void fill_block_mtp_avx2_impl(const block *prev_block, const block *ref_block,
+                                     block *next_block, int with_xor, uint32_t block_index,
+                                     const uint8_t *hash_zero) {
+    __m256i state[ARGON2_HWORDS_IN_BLOCK];
+    __m256i block_XY[ARGON2_HWORDS_IN_BLOCK];
+    unsigned int i;
+
+    /* state = ref_block + prev_block, block_XY = state (+ next_block) */
+    for (i = 0; i < ARGON2_HWORDS_IN_BLOCK; i++) {
+        state[i] = _mm256_xor_si256(
+            _mm256_loadu_si256((const __m256i *)prev_block->v + i),
+            _mm256_loadu_si256((const __m256i *)ref_block->v + i));
+        block_XY[i] = with_xor
+            ? _mm256_xor_si256(state[i], _mm256_loadu_si256((const __m256i *)next_block->v + i))
+            : state[i];
+    }
+
+    /* Word 14 takes the block index in its high half, words 16 to 19 the
+       first 32 bytes of hash_zero, as in fill_block_mtp_ref */
+    state[3] = _mm256_insert_epi64(state[3], (int64_t)((uint64_t)block_index << 32), 2);
+    state[4] = _mm256_loadu_si256((const __m256i *)hash_zero);
+
+    for (i = 0; i < 4; ++i) {
+        BLAKE2_ROUND_1(state[8 * i + 0], state[8 * i + 4], state[8 * i + 1], state[8 * i + 5],
+                       state[8 * i + 2], state[8 * i + 6], state[8 * i + 3], state[8 * i + 7]);
+    }
+
+    for (i = 0; i < 4; ++i) {
+        BLAKE2_ROUND_2(state[ 0 + i], state[ 4 + i], state[ 8 + i], state[12 + i],
+                       state[16 + i], state[20 + i], state[24 + i], state[28 + i]);
+    }
+
+    for (i = 0; i < ARGON2_HWORDS_IN_BLOCK; i++) {
+        state[i] = _mm256_xor_si256(state[i], block_XY[i]);
+        _mm256_storeu_si256((__m256i *)next_block->v + i, state[i]);
+    }
+}
+
+#pragma GCC pop_options
+
+static int fill_block_mtp_use_avx2 = 0;
+
+__attribute__((constructor)) static void fill_block_mtp_init(void) {
+    __builtin_cpu_init();
+    fill_block_mtp_use_avx2 = __builtin_cpu_supports("avx2");
+}
+
+int fill_block_mtp_avx2(const block *prev_block, const block *ref_block,
+                        block *next_block, int with_xor, uint32_t block_index,
+                        const uint8_t *hash_zero) {
+    if (!fill_block_mtp_use_avx2) {
+        return 0;
+    }
+    fill_block_mtp_avx2_impl(prev_block, ref_block, next_block, with_xor,
+                             block_index, hash_zero);
+    return 1;
+}
+
+#else
+
+int fill_block_mtp_avx2(const block *prev_block, const block *ref_block,
+                        block *next_block, int with_xor, uint32_t block_index,
+                        const uint8_t *hash_zero) {
+    (void)prev_block;
+    (void)ref_block;
+    (void)next_block;
+    (void)with_xor;
+    (void)block_index;
+    (void)hash_zero;
+    return 0;
+}
+
+#endif
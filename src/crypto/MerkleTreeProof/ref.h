@@ -29,7 +29,7 @@
  * @param with_xor Whether to XOR into the new block (1) or just overwrite (0)
  * @pre all block pointers must be valid
  */
-static void fill_block_mtp(const block *prev_block, const block *ref_block,
+static void fill_block_mtp_ref(const block *prev_block, const block *ref_block,
                        block *next_block, int with_xor, uint32_t block_index, uint8_t * hash_zero) {
     block blockR, block_tmp;
     unsigned i;
@@ -91,4 +91,17 @@ static void fill_block_mtp(const block *prev_block, const block *ref_block,
 }
 
 
+/*
+ * fill_block_mtp_ref, or its AVX2 version when the build and the CPU support it
+ */
+static inline void fill_block_mtp(const block *prev_block, const block *ref_block,
+                       block *next_block, int with_xor, uint32_t block_index, uint8_t * hash_zero) {
+    if (!fill_block_mtp_avx2(prev_block, ref_block, next_block, with_xor,
+                             block_index, hash_zero)) {
+        fill_block_mtp_ref(prev_block, ref_block, next_block, with_xor,
+                           block_index, hash_zero);
+    }
+}
+
+
 #endif /* SRC_REF_H_ */
@@ -12,6 +12,145 @@ extern "C" {
 #include "crypto/ctaes/ctaes.c"
 }
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#define ENABLE_AESNI 1
+#include <cpuid.h>
+#include <wmmintrin.h>
+#endif
+
+#ifdef ENABLE_AESNI
+namespace aesni
+{
+#define AESNI_TARGET __attribute__((target("aes,sse2")))
+
+AESNI_TARGET static inline __m128i ExpandEven(__m128i prev, __m128i assist)
+{
+    assist = _mm_shuffle_epi32(assist, 0xff);
+    prev = _mm_xor_si128(prev, _mm_slli_si128(prev, 4));
+    prev = _mm_xor_si128(prev, _mm_slli_si128(prev, 4));
+    prev = _mm_xor_si128(prev, _mm_slli_si128(prev, 4));
+    return _mm_xor_si128(prev, assist);
+}
+
+AESNI_TARGET static inline __m128i ExpandOdd(__m128i even, __m128i prev)
+{
+    __m128i assist = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(even, 0x00), 0xaa);
+    prev = _mm_xor_si128(prev, _mm_slli_si128(prev, 4));
+    prev = _mm_xor_si128(prev, _mm_slli_si128(prev, 4));
+    prev = _mm_xor_si128(prev, _mm_slli_si128(prev, 4));
+    return _mm_xor_si128(prev, assist);
+}
+
+/** AES-256 key expansion, as in the Intel AES-NI white paper. */
+AESNI_TARGET static void ExpandKey(__m128i rk[AES256_ROUNDKEYS], const unsigned char key[32])
+{
+    rk[0] = _mm_loadu_si128((const __m128i*)key);
+    rk[1] = _mm_loadu_si128((const __m128i*)(key + 16));
+#define AESNI_EXPAND(i, rcon) \
+    rk[i] = ExpandEven(rk[i - 2], _mm_aeskeygenassist_si128(rk[i - 1], rcon)); \
+    rk[i + 1] = ExpandOdd(rk[i], rk[i - 1]);
+    AESNI_EXPAND(2, 0x01)
+    AESNI_EXPAND(4, 0x02)
+    AESNI_EXPAND(6, 0x04)
+    AESNI_EXPAND(8, 0x08)
+    AESNI_EXPAND(10, 0x10)
+    AESNI_EXPAND(12, 0x20)
+    rk[14] = ExpandEven(rk[12], _mm_aeskeygenassist_si128(rk[13], 0x40));
+#undef AESNI_EXPAND
+}
+
+AESNI_TARGET static void InitEncrypt(unsigned char roundKeys[AES256_ROUNDKEYS * AES_BLOCKSIZE], const unsigned char key[32])
+{
+    __m128i rk[AES256_ROUNDKEYS];
+    ExpandKey(rk, key);
+    for (int i = 0; i < AES256_ROUNDKEYS; i++) {
+        _mm_storeu_si128((__m128i*)(roundKeys + i * AES_BLOCKSIZE), rk[i]);
+    }
+    memset(rk, 0, sizeof(rk));
+}
+
+/** Key schedule for the equivalent inverse cipher: reversed, with InvMixColumns on the inner round keys. */
+AESNI_TARGET static void InitDecrypt(unsigned char roundKeys[AES256_ROUNDKEYS * AES_BLOCKSIZE], const unsigned char key[32])
+{
+    __m128i rk[AES256_ROUNDKEYS];
+    ExpandKey(rk, key);
+    _mm_storeu_si128((__m128i*)roundKeys, rk[AES256_ROUNDKEYS - 1]);
+    for (int i = 1; i < AES256_ROUNDKEYS - 1; i++) {
+        _mm_storeu_si128((__m128i*)(roundKeys + i * AES_BLOCKSIZE), _mm_aesimc_si128(rk[AES256_ROUNDKEYS - 1 - i]));
+    }
+    _mm_storeu_si128((__m128i*)(roundKeys + (AES256_ROUNDKEYS - 1) * AES_BLOCKSIZE), rk[0]);
+    memset(rk, 0, sizeof(rk));
+}
+
+AESNI_TARGET static void Encrypt(const unsigned char roundKeys[AES256_ROUNDKEYS * AES_BLOCKSIZE], unsigned char out[16], const unsigned char in[16])
+{
+    const __m128i* rk = (const __m128i*)roundKeys;
+    __m128i block = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), _mm_loadu_si128(rk));
+    for (int i = 1; i < AES256_ROUNDKEYS - 1; i++) {
+        block = _mm_aesenc_si128(block, _mm_loadu_si128(rk + i));
+    }
+    block = _mm_aesenclast_si128(block, _mm_loadu_si128(rk + AES256_ROUNDKEYS - 1));
+    _mm_storeu_si128((__m128i*)out, block);
+}
+
+AESNI_TARGET static void Decrypt(const unsigned char roundKeys[AES256_ROUNDKEYS * AES_BLOCKSIZE], unsigned char out[16], const unsigned char in[16])
+{
+    const __m128i* rk = (const __m128i*)roundKeys;
+    __m128i block = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), _mm_loadu_si128(rk));
+    for (int i = 1; i < AES256_ROUNDKEYS - 1; i++) {
+        block = _mm_aesdec_si128(block, _mm_loadu_si128(rk + i));
+    }
+    block = _mm_aesdeclast_si128(block, _mm_loadu_si128(rk + AES256_ROUNDKEYS - 1));
+    _mm_storeu_si128((__m128i*)out, block);
+}
+
+#undef AESNI_TARGET
+
+/** Checks the AES-NI code against the FIPS-197 AES-256 example vector. */
+static bool SelfTest()
+{
+    static const unsigned char key[32] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+        0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f};
+    static const unsigned char plaintext[16] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+    static const unsigned char ciphertext[16] = {
+        0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89};
+
+    unsigned char roundKeys[AES256_ROUNDKEYS * AES_BLOCKSIZE];
+    unsigned char buf[16];
+    InitEncrypt(roundKeys, key);
+    Encrypt(roundKeys, buf, plaintext);
+    if (memcmp(buf, ciphertext, sizeof(buf))) return false;
+    InitDecrypt(roundKeys, key);
+    Decrypt(roundKeys, buf, ciphertext);
+    return memcmp(buf, plaintext, sizeof(buf)) == 0;
+}
+
+static bool Detect()
+{
+    uint32_t eax, ebx, ecx, edx;
+    // CPUID.1:ECX.AESNI[bit 25]
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !((ecx >> 25) & 1)) {
+        return false;
+    }
+    assert(SelfTest());
+    return true;
+}
+
+} // namespace aesni
+#endif
+
+bool AES256HasHardwareSupport()
+{
+#ifdef ENABLE_AESNI
+    static const bool fHardware = aesni::Detect();
+    return fHardware;
+#else
+    return false;
+#endif
+}
+
 AES128Encrypt::AES128Encrypt(const unsigned char key[16])
 {
     AES128_init(&ctx, key);
@@ -44,31 +183,57 @@ void AES128Decrypt::Decrypt(unsigned char plaintext[16], const unsigned char cip
 
 AES256Encrypt::AES256Encrypt(const unsigned char key[32])
 {
+#ifdef ENABLE_AESNI
+    if (AES256HasHardwareSupport()) {
+        aesni::InitEncrypt(roundKeys, key);
+        return;
+    }
+#endif
     AES256_init(&ctx, key);
 }
 
 AES256Encrypt::~AES256Encrypt()
 {
     memset(&ctx, 0, sizeof(ctx));
+    memset(roundKeys, 0, sizeof(roundKeys));
 }
 
 void AES256Encrypt::Encrypt(unsigned char ciphertext[16], const unsigned char plaintext[16]) const
 {
+#ifdef ENABLE_AESNI
+    if (AES256HasHardwareSupport()) {
+        aesni::Encrypt(roundKeys, ciphertext, plaintext);
+        return;
+    }
+#endif
     AES256_encrypt(&ctx, 1, ciphertext, plaintext);
 }
 
 AES256Decrypt::AES256Decrypt(const unsigned char key[32])
 {
+#ifdef ENABLE_AESNI
+    if (AES256HasHardwareSupport()) {
+        aesni::InitDecrypt(roundKeys, key);
+        return;
+    }
+#endif
     AES256_init(&ctx, key);
 }
 
 AES256Decrypt::~AES256Decrypt()
 {
     memset(&ctx, 0, sizeof(ctx));
+    memset(roundKeys, 0, sizeof(roundKeys));
 }
 
 void AES256Decrypt::Decrypt(unsigned char plaintext[16], const unsigned char ciphertext[16]) const
 {
+#ifdef ENABLE_AESNI
+    if (AES256HasHardwareSupport()) {
+        aesni::Decrypt(roundKeys, plaintext, ciphertext);
+        return;
+    }
+#endif
     AES256_decrypt(&ctx, 1, plaintext, ciphertext);
 }
 
@@ -39,11 +39,19 @@ public:
     void Decrypt(unsigned char plaintext[16], const unsigned char ciphertext[16]) const;
 };
 
+/** Number of AES-256 round keys, each AES_BLOCKSIZE bytes long. */
+static const int AES256_ROUNDKEYS = 15;
+
+/** Returns true if AES-256 runs on the AES-NI instructions of this CPU. */
+bool AES256HasHardwareSupport();
+
 /** An encryption class for AES-256. */
 class AES256Encrypt
 {
 private:
     AES256_ctx ctx;
+    //! key schedule used instead of ctx when AES256HasHardwareSupport()
+    unsigned char roundKeys[AES256_ROUNDKEYS * AES_BLOCKSIZE];
 
 public:
     AES256Encrypt(const unsigned char key[32]);
@@ -56,6 +64,8 @@ class AES256Decrypt
 {
 private:
     AES256_ctx ctx;
+    //! inverse key schedule used instead of ctx when AES256HasHardwareSupport()
+    unsigned char roundKeys[AES256_ROUNDKEYS * AES_BLOCKSIZE];
 
 public:
     AES256Decrypt(const unsigned char key[32]);
@@ -38,14 +38,132 @@ static inline uint256 H256ToU256(const ethash::hash256& in) {
     return ret;
 }
 
-uint256 progpow_hash_full(const CProgPowHeader& header, uint256& mix_hash)
+static CProgPowEpochContexts::ContextPtr CreateEpochContext(int nEpoch)
+{
+    ethash::epoch_context* context = ethash_create_epoch_context(nEpoch);
+    if (!context)
+        throw std::bad_alloc();
+    return CProgPowEpochContexts::ContextPtr(context, ethash_destroy_epoch_context);
+}
+
+CProgPowEpochContexts& CProgPowEpochContexts::Instance()
+{
+    static CProgPowEpochContexts instance;
+    return instance;
+}
+
+CProgPowEpochContexts::~CProgPowEpochContexts()
 {
-    static ethash::epoch_context_ptr epochContext{nullptr,nullptr};
-    if (!epochContext || epochContext->epoch_number != ethash::get_epoch_number(header.nHeight))
     {
-        epochContext.reset();
-        epochContext = ethash::create_epoch_context(ethash::get_epoch_number(header.nHeight));
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    cond.notify_all();
+    if (prebuildThread.joinable())
+        prebuildThread.join();
+}
+
+CProgPowEpochContexts::ContextPtr CProgPowEpochContexts::GetContext(int nHeight)
+{
+    const int nEpoch = ethash::get_epoch_number(nHeight);
+
+    std::unique_lock<std::mutex> lock(cs);
+    nLatestEpoch = std::max(nLatestEpoch, nEpoch);
+    ContextPtr context = Acquire(lock, nEpoch);
+
+    if (nEpoch == nLatestEpoch && nHeight % ethash::epoch_length >= ethash::epoch_length - PROGPOW_EPOCH_PREBUILD_BLOCKS
+            && !contexts.count(nEpoch + 1) && !building.count(nEpoch + 1) && nPrebuildEpoch < 0) {
+        nPrebuildEpoch = nEpoch + 1;
+        building.insert(nPrebuildEpoch);
+        if (!prebuildThread.joinable())
+            prebuildThread = std::thread(&CProgPowEpochContexts::PrebuildLoop, this);
+        cond.notify_all();
+    }
+
+    return context;
+}
+
+bool CProgPowEpochContexts::IsReady(int nEpoch) const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return contexts.count(nEpoch) > 0;
+}
+
+CProgPowEpochContexts::ContextPtr CProgPowEpochContexts::Acquire(std::unique_lock<std::mutex>& lock, int nEpoch)
+{
+    while (true) {
+        auto it = contexts.find(nEpoch);
+        if (it != contexts.end()) {
+            it->second.nLastUse = ++nUseCounter;
+            return it->second.context;
+        }
+
+        if (building.count(nEpoch)) {
+            cond.wait(lock);
+            continue;
+        }
+
+        // Build it on this thread, others asking for the epoch wait for it
+        building.insert(nEpoch);
+        lock.unlock();
+        ContextPtr context;
+        try {
+            context = CreateEpochContext(nEpoch);
+        } catch (...) {
+            lock.lock();
+            building.erase(nEpoch);
+            cond.notify_all();
+            throw;
+        }
+        lock.lock();
+        Publish(nEpoch, context);
+        return context;
+    }
+}
+
+void CProgPowEpochContexts::Publish(int nEpoch, ContextPtr context)
+{
+    building.erase(nEpoch);
+    if (context)
+        contexts[nEpoch] = CachedContext{std::move(context), ++nUseCounter};
+
+    // Evict the least recently used contexts, holders keep evicted ones alive
+    while (contexts.size() > PROGPOW_EPOCH_CONTEXTS_CACHED) {
+        auto lru = contexts.begin();
+        for (auto it = contexts.begin(); it != contexts.end(); ++it) {
+            if (it->second.nLastUse < lru->second.nLastUse)
+                lru = it;
+        }
+        contexts.erase(lru);
+    }
+    cond.notify_all();
+}
+
+void CProgPowEpochContexts::PrebuildLoop()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    while (true) {
+        cond.wait(lock, [this] { return fStop || nPrebuildEpoch >= 0; });
+        if (fStop)
+            return;
+
+        const int nEpoch = nPrebuildEpoch;
+        lock.unlock();
+        ContextPtr context;
+        try {
+            context = CreateEpochContext(nEpoch);
+        } catch (const std::bad_alloc&) {
+            // Callers will try again on their own thread
+        }
+        lock.lock();
+        nPrebuildEpoch = -1;
+        Publish(nEpoch, std::move(context));
     }
+}
+
+uint256 progpow_hash_full(const CProgPowHeader& header, uint256& mix_hash)
+{
+    const CProgPowEpochContexts::ContextPtr epochContext = CProgPowEpochContexts::Instance().GetContext(header.nHeight);
 
     const auto header_h256{U256ToH256(SerializeHash(header))};
     const auto result = progpow::hash(*epochContext, header.nHeight, header_h256, header.nNonce64);
@@ -63,4 +181,14 @@ uint256 progpow_hash_light(const CProgPowHeader& header)
     const auto seed_h256{progpow::hash_seed(header_h256, header.nNonce64)};
     const auto final_h256{progpow::hash_final(seed_h256, mix_h256)};
     return H256ToU256(final_h256);
-}
\ No newline at end of file
+}
+
+bool progpow_verify_full(const CProgPowHeader& header, const uint256& boundary)
+{
+    const CProgPowEpochContexts::ContextPtr epochContext = CProgPowEpochContexts::Instance().GetContext(header.nHeight);
+
+    const auto header_h256{U256ToH256(SerializeHash(header))};
+    const auto mix_h256{U256ToH256(header.mix_hash)};
+    const auto boundary_h256{U256ToH256(boundary)};
+    return progpow::verify(*epochContext, header.nHeight, header_h256, mix_h256, header.nNonce64, boundary_h256);
+}
@@ -11,6 +11,18 @@
 #include <uint256.h>
 #include <serialize.h>
 
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+/** Blocks before an epoch boundary at which the next epoch context starts to be built */
+static const int PROGPOW_EPOCH_PREBUILD_BLOCKS = 100;
+/** Number of most recently used epoch contexts kept around */
+static const size_t PROGPOW_EPOCH_CONTEXTS_CACHED = 4;
+
 /**
  * Serializer for ProgPow BlockHeader input
 */
@@ -39,10 +51,58 @@ public:
     }
 };
 
+/**
+ * Epoch contexts (light caches) shared by all threads running full ProgPoW hashes.
+ *
+ * Keeps the PROGPOW_EPOCH_CONTEXTS_CACHED most recently used contexts, so checks
+ * going back to older epochs (reorgs, initial sync) reuse theirs. When a
+ * height gets within PROGPOW_EPOCH_PREBUILD_BLOCKS of the next epoch, that epoch's
+ * context is built on a background thread so callers crossing the boundary don't
+ * stall. Contexts are handed out refcounted and stay valid while they are held.
+ */
+class CProgPowEpochContexts
+{
+public:
+    using ContextPtr = std::shared_ptr<const ethash::epoch_context>;
+
+    ~CProgPowEpochContexts();
+
+    /** Returns the context for the height, waiting for it if it is being built */
+    ContextPtr GetContext(int nHeight);
+    bool IsReady(int nEpoch) const;
+
+    static CProgPowEpochContexts& Instance();
+
+private:
+    mutable std::mutex cs;
+    std::condition_variable cond;
+    struct CachedContext {
+        ContextPtr context;
+        //! value of nUseCounter when the context was last handed out
+        uint64_t nLastUse;
+    };
+    std::map<int, CachedContext> contexts;
+    uint64_t nUseCounter{0};
+    //! epochs being built by a caller or the background thread
+    std::set<int> building;
+    int nLatestEpoch{-1};
+
+    std::thread prebuildThread;
+    int nPrebuildEpoch{-1};
+    bool fStop{false};
+
+    ContextPtr Acquire(std::unique_lock<std::mutex>& lock, int nEpoch);
+    void Publish(int nEpoch, ContextPtr context);
+    void PrebuildLoop();
+};
+
 /* Performs a full progpow hash (DAG loops implied) provided header already hash nHeight valued */
 uint256 progpow_hash_full(const CProgPowHeader& header, uint256& mix_hash);
 
 /* Performs a light progpow hash (DAG loops excluded) provided header has mix_hash */
 uint256 progpow_hash_light(const CProgPowHeader& header);
 
+/* Fully verifies header's mix_hash and that the final hash doesn't exceed boundary (DAG loops implied) */
+bool progpow_verify_full(const CProgPowHeader& header, const uint256& boundary);
+
 #endif // FIRO_PROGPOW_H
@@ -171,4 +171,114 @@ BOOST_AUTO_TEST_CASE(regenerate_mint)
         entry1.ecdsaSecretKey.begin(), entry1.ecdsaSecretKey.end());
 }
 
+BOOST_AUTO_TEST_CASE(tracker_private_balance)
+{
+    auto &tracker = pwalletMain->zwallet->GetTracker();
+    auto before = tracker.GetPrivateBalance();
+
+    lelantus::PrivateCoin coin(params, 5 * COIN);
+
+    CHDMint mint;
+    CWalletDB walletdb(pwalletMain->strWalletFile);
+    uint160 seedID;
+    BOOST_CHECK(pwalletMain->zwallet->GenerateLelantusMint(walletdb, coin, mint, seedID));
+
+    // new mint is unconfirmed
+    tracker.AddLelantus(walletdb, mint, true);
+
+    auto balance = tracker.GetPrivateBalance();
+    BOOST_CHECK_EQUAL(before.confirmed, balance.confirmed);
+    BOOST_CHECK_EQUAL(before.unconfirmed + 5 * COIN, balance.unconfirmed);
+    BOOST_CHECK_EQUAL(before.nConfirmed, balance.nConfirmed);
+    BOOST_CHECK_EQUAL(before.nUnconfirmed + 1, balance.nUnconfirmed);
+
+    // mined
+    CLelantusMintMeta meta;
+    BOOST_CHECK(tracker.GetMetaFromSerial(mint.GetSerialHash(), meta));
+    meta.nHeight = 1;
+    meta.nId = 1;
+    BOOST_CHECK(tracker.UpdateState(meta));
+
+    balance = tracker.GetPrivateBalance();
+    BOOST_CHECK_EQUAL(before.confirmed + 5 * COIN, balance.confirmed);
+    BOOST_CHECK_EQUAL(before.unconfirmed, balance.unconfirmed);
+    BOOST_CHECK_EQUAL(before.nConfirmed + 1, balance.nConfirmed);
+    BOOST_CHECK_EQUAL(before.nUnconfirmed, balance.nUnconfirmed);
+
+    // spent
+    tracker.SetLelantusPubcoinUsed(meta.GetPubCoinValueHash(), uint256());
+
+    balance = tracker.GetPrivateBalance();
+    BOOST_CHECK_EQUAL(before.confirmed, balance.confirmed);
+    BOOST_CHECK_EQUAL(before.unconfirmed, balance.unconfirmed);
+    BOOST_CHECK_EQUAL(before.nConfirmed, balance.nConfirmed);
+    BOOST_CHECK_EQUAL(before.nUnconfirmed, balance.nUnconfirmed);
+
+    // spend rolled back
+    tracker.SetLelantusPubcoinNotUsed(meta.GetPubCoinValueHash());
+
+    balance = tracker.GetPrivateBalance();
+    BOOST_CHECK_EQUAL(before.confirmed + 5 * COIN, balance.confirmed);
+    BOOST_CHECK_EQUAL(before.nConfirmed + 1, balance.nConfirmed);
+}
+
+BOOST_AUTO_TEST_CASE(tracker_select_mints)
+{
+    auto &tracker = pwalletMain->zwallet->GetTracker();
+    CWalletDB walletdb(pwalletMain->strWalletFile);
+
+    // amount and height of each mint
+    std::vector<std::pair<CAmount, int>> mints = {{1 * COIN, 3}, {3 * COIN, 2}, {3 * COIN, 1}, {5 * COIN, 1}, {8 * COIN, 0}};
+    std::vector<CLelantusMintMeta> metas;
+    for (auto const &m : mints) {
+        lelantus::PrivateCoin coin(params, m.first);
+        CHDMint mint;
+        uint160 seedID;
+        BOOST_CHECK(pwalletMain->zwallet->GenerateLelantusMint(walletdb, coin, mint, seedID));
+        tracker.AddLelantus(walletdb, mint, true);
+
+        CLelantusMintMeta meta;
+        BOOST_CHECK(tracker.GetMetaFromSerial(mint.GetSerialHash(), meta));
+        meta.nHeight = m.second;
+        meta.nId = 1;
+        BOOST_CHECK(tracker.UpdateState(meta));
+        metas.push_back(meta);
+    }
+
+    // only consider the mints of this test
+    std::set<uint256> ours;
+    for (auto const &meta : metas)
+        ours.insert(meta.hashSerial);
+    auto isOurs = [&](const CLelantusMintMeta& meta) { return ours.count(meta.hashSerial) > 0; };
+
+    auto select = [&](CAmount required) {
+        std::vector<uint256> serials;
+        for (auto const &meta : tracker.SelectLelantusMints(required, isOurs))
+            serials.push_back(meta.hashSerial);
+        return serials;
+    };
+
+    // smallest mint covering the amount, the oldest one on ties, unconfirmed mint is not used
+    BOOST_CHECK(select(4 * COIN) == std::vector<uint256>({metas[3].hashSerial}));
+    BOOST_CHECK(select(2 * COIN) == std::vector<uint256>({metas[2].hashSerial}));
+    // biggest first while it does not cover the rest
+    BOOST_CHECK(select(6 * COIN) == std::vector<uint256>({metas[3].hashSerial, metas[0].hashSerial}));
+    BOOST_CHECK(select(12 * COIN) == std::vector<uint256>({metas[3].hashSerial, metas[2].hashSerial, metas[1].hashSerial, metas[0].hashSerial}));
+    // not enough funds
+    BOOST_CHECK_EQUAL(select(13 * COIN).size(), 4U);
+
+    // spent mint is out of the index, a rejected candidate is passed over
+    tracker.SetLelantusPubcoinUsed(metas[3].GetPubCoinValueHash(), uint256());
+    ours.erase(metas[2].hashSerial);
+    BOOST_CHECK(select(4 * COIN) == std::vector<uint256>({metas[1].hashSerial, metas[0].hashSerial}));
+
+    // the predicate is evaluated at most once per mint
+    std::map<uint256, int> calls;
+    auto countCalls = [&](const CLelantusMintMeta& meta) { calls[meta.hashSerial]++; return isOurs(meta); };
+    BOOST_CHECK_EQUAL(tracker.SelectLelantusMints(100 * COIN, countCalls).size(), 2U);
+    BOOST_CHECK(!calls.empty());
+    for (auto const &c : calls)
+        BOOST_CHECK_EQUAL(c.second, 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
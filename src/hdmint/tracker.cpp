@@ -75,8 +75,11 @@ bool CHDMintTracker::Archive(CMintMeta& meta)
 {
     uint256 hashPubcoin = meta.GetPubCoinValueHash();
 
-    if (HasSerialHash(meta.hashSerial))
-        mapSerialHashes.at(meta.hashSerial).isArchived = true;
+    if (HasSerialHash(meta.hashSerial)) {
+        CMintMeta archived = mapSerialHashes.at(meta.hashSerial);
+        archived.isArchived = true;
+        SetMeta(archived);
+    }
 
    CWalletDB walletdb(strWalletFile);
     CHDMint dMint;
@@ -93,8 +96,11 @@ bool CHDMintTracker::Archive(CLelantusMintMeta& meta)
 {
     uint256 hashPubcoin = meta.GetPubCoinValueHash();
 
-    if (HasLelantusSerialHash(meta.hashSerial))
-        mapLelantusSerialHashes.at(meta.hashSerial).isArchived = true;
+    if (HasLelantusSerialHash(meta.hashSerial)) {
+        CLelantusMintMeta archived = mapLelantusSerialHashes.at(meta.hashSerial);
+        archived.isArchived = true;
+        SetMeta(archived);
+    }
 
     CWalletDB walletdb(strWalletFile);
     CHDMint dMint;
@@ -252,6 +258,171 @@ bool CHDMintTracker::HasLelantusSerialHash(const uint256& hashSerial) const
     return it != mapLelantusSerialHashes.end();
 }
 
+void CPrivateBalance::Add(CAmount amount, bool fConfirmed)
+{
+    if (fConfirmed) {
+        confirmed += amount;
+        nConfirmed++;
+    } else {
+        unconfirmed += amount;
+        nUnconfirmed++;
+    }
+}
+
+void CPrivateBalance::Remove(CAmount amount, bool fConfirmed)
+{
+    if (fConfirmed) {
+        confirmed -= amount;
+        nConfirmed--;
+    } else {
+        unconfirmed -= amount;
+        nUnconfirmed--;
+    }
+}
+
+// A mint counts as confirmed once it is in a block; deeper confirmation
+// requirements would make the tally depend on the chain height
+static_assert(ZC_MINT_CONFIRMATIONS == 1, "private balance tally assumes mints confirm at depth 1");
+
+void CHDMintTracker::UpdateBalance(const CMintMeta& meta, bool fAdd)
+{
+    if (meta.isUsed || meta.isArchived || !meta.isSeedCorrect)
+        return;
+
+    CAmount amount;
+    if (!sigma::DenominationToInteger(meta.denom, amount))
+        return;
+
+    bool fConfirmed = meta.nHeight > 0;
+    if (fAdd)
+        sigmaBalance.Add(amount, fConfirmed);
+    else
+        sigmaBalance.Remove(amount, fConfirmed);
+}
+
+void CHDMintTracker::UpdateBalance(const CLelantusMintMeta& meta, bool fAdd)
+{
+    if (meta.isUsed || meta.isArchived || !meta.isSeedCorrect)
+        return;
+
+    bool fConfirmed = meta.nHeight > 0;
+    if (fAdd)
+        lelantusBalance.Add(meta.amount, fConfirmed);
+    else
+        lelantusBalance.Remove(meta.amount, fConfirmed);
+}
+
+/**
+ * Store a meta object in memory, replacing any object with the same serial hash,
+ * and move the balance totals accordingly.
+ *
+ * @param meta the CMintMeta object to store
+ * @return void
+ */
+void CHDMintTracker::SetMeta(const CMintMeta& meta)
+{
+    auto it = mapSerialHashes.find(meta.hashSerial);
+    if (it != mapSerialHashes.end()) {
+        UpdateBalance(it->second, false);
+        it->second = meta;
+    } else {
+        mapSerialHashes.emplace(meta.hashSerial, meta);
+    }
+    UpdateBalance(meta, true);
+}
+
+bool CHDMintTracker::IsInAmountIndex(const CLelantusMintMeta& meta)
+{
+    return !meta.isUsed && !meta.isArchived && meta.isSeedCorrect && meta.amount != 0 && meta.nHeight > 0;
+}
+
+void CHDMintTracker::SetMeta(const CLelantusMintMeta& meta)
+{
+    auto it = mapLelantusSerialHashes.find(meta.hashSerial);
+    if (it != mapLelantusSerialHashes.end()) {
+        UpdateBalance(it->second, false);
+        if (IsInAmountIndex(it->second))
+            setLelantusAmountIndex.erase({(CAmount)it->second.amount, it->second.nHeight, it->second.hashSerial});
+        it->second = meta;
+    } else {
+        mapLelantusSerialHashes.emplace(meta.hashSerial, meta);
+    }
+    UpdateBalance(meta, true);
+    if (IsInAmountIndex(meta))
+        setLelantusAmountIndex.insert({(CAmount)meta.amount, meta.nHeight, meta.hashSerial});
+}
+
+/**
+ * Get the balance of the spendable mints, Sigma and Lelantus combined.
+ *
+ * @return confirmed and unconfirmed amounts and mint counts
+ */
+CPrivateBalance CHDMintTracker::GetPrivateBalance() const
+{
+    CPrivateBalance balance = sigmaBalance;
+    balance.confirmed += lelantusBalance.confirmed;
+    balance.unconfirmed += lelantusBalance.unconfirmed;
+    balance.nConfirmed += lelantusBalance.nConfirmed;
+    balance.nUnconfirmed += lelantusBalance.nUnconfirmed;
+    return balance;
+}
+
+/**
+ * Select Lelantus mints to cover the required amount from the amount index.
+ *
+ * While the remaining amount is at least the biggest available mint, the biggest
+ * one is taken, otherwise the smallest mint covering the remainder; older mints
+ * are preferred among equal amounts. Each lookup is logarithmic, the isSpendable
+ * predicate is only evaluated once per candidate on the way, as it can be costly,
+ * and mints it rejects are passed over. Nothing is read from the database.
+ *
+ * @param required amount to cover
+ * @param isSpendable chain and wallet side checks a candidate has to pass
+ * @return selected mints, covering less than required if funds are insufficient
+ */
+std::vector<CLelantusMintMeta> CHDMintTracker::SelectLelantusMints(CAmount required, const std::function<bool(const CLelantusMintMeta&)>& isSpendable) const
+{
+    std::vector<CLelantusMintMeta> selected;
+    std::set<uint256> setSelected;
+    std::map<uint256, bool> mapSpendable; // isSpendable result by serial hash
+
+    auto isCandidate = [&](const CLelantusAmountIndexKey& key) {
+        if (setSelected.count(key.hashSerial))
+            return false;
+        auto it = mapSpendable.find(key.hashSerial);
+        if (it == mapSpendable.end())
+            it = mapSpendable.emplace(key.hashSerial, isSpendable(mapLelantusSerialHashes.at(key.hashSerial))).first;
+        return it->second;
+    };
+
+    // oldest candidate having the smallest amount not below the given one
+    auto lowerBound = [&](CAmount amount) {
+        auto it = setLelantusAmountIndex.lower_bound({amount, std::numeric_limits<int>::min(), uint256()});
+        while (it != setLelantusAmountIndex.end() && !isCandidate(*it))
+            ++it;
+        return it;
+    };
+
+    CAmount selectedAmount = 0;
+    while (selectedAmount < required) {
+        auto rit = setLelantusAmountIndex.rbegin();
+        while (rit != setLelantusAmountIndex.rend() && !isCandidate(*rit))
+            ++rit;
+        if (rit == setLelantusAmountIndex.rend())
+            break;
+
+        CAmount need = required - selectedAmount;
+        auto it = lowerBound(need >= rit->amount ? rit->amount : need);
+        assert(it != setLelantusAmountIndex.end());
+
+        selected.push_back(mapLelantusSerialHashes.at(it->hashSerial));
+        selectedAmount += it->amount;
+        setSelected.insert(it->hashSerial);
+    }
+
+    return selected;
+}
+
 /**
  * Update the tracker state
  *
@@ -325,7 +496,7 @@ bool CHDMintTracker::UpdateState(const CMintMeta& meta)
             CT_UPDATED);
     }
 
-    mapSerialHashes[meta.hashSerial] = meta;
+    SetMeta(meta);
 
     return true;
 }
@@ -374,7 +545,7 @@ bool CHDMintTracker::UpdateState(const CLelantusMintMeta& meta)
             std::string("Update (") + std::to_string((double)dMint.GetAmount() / COIN) + "mint)",
             CT_UPDATED);
 
-    mapLelantusSerialHashes[meta.hashSerial] = meta;
+    SetMeta(meta);
 
     return true;
 }
@@ -406,7 +577,7 @@ void CHDMintTracker::Add(CWalletDB& walletdb, const CHDMint& dMint, bool isNew,
     meta.isArchived = isArchived;
     meta.isDeterministic = true;
     meta.isSeedCorrect = true;
-    mapSerialHashes[meta.hashSerial] = meta;
+    SetMeta(meta);
 
     pwalletMain->NotifyZerocoinChanged(
         pwalletMain,
@@ -430,7 +601,7 @@ void CHDMintTracker::AddLelantus(CWalletDB& walletdb, const CHDMint& dMint, bool
     meta.amount = dMint.GetAmount();
     meta.isArchived = isArchived;
     meta.isSeedCorrect = true;
-    mapLelantusSerialHashes[meta.hashSerial] = meta;
+    SetMeta(meta);
 
     pwalletMain->NotifyZerocoinChanged(
             pwalletMain,
@@ -458,7 +629,7 @@ void CHDMintTracker::Add(CWalletDB& walletdb, const CSigmaEntry& sigma, bool isN
     meta.isArchived = isArchived;
     meta.isDeterministic = false;
     meta.isSeedCorrect = true;
-    mapSerialHashes[meta.hashSerial] = meta;
+    SetMeta(meta);
 
     if (isNew)
         walletdb.WriteSigmaEntry(sigma);
@@ -1292,4 +1463,5 @@ std::set<uint256> CHDMintTracker::GetMempoolTxids(){
 void CHDMintTracker::Clear()
 {
     mapSerialHashes.clear();
+    sigmaBalance = CPrivateBalance();
 }
@@ -8,11 +8,44 @@
 #include "primitives/mint_spend.h"
 #include "hdmint/mintpool.h"
 #include "wallet/walletdb.h"
+#include <functional>
 #include <list>
+#include <set>
+#include <tuple>
 
 class CHDMint;
 class CHDMintWallet;
 
+/**
+ * Running total of the spendable (unused, unarchived, correct seed) mints, split
+ * into confirmed and unconfirmed ones.
+ */
+struct CPrivateBalance
+{
+    CAmount confirmed = 0;
+    CAmount unconfirmed = 0;
+    size_t nConfirmed = 0;
+    size_t nUnconfirmed = 0;
+
+    void Add(CAmount amount, bool fConfirmed);
+    void Remove(CAmount amount, bool fConfirmed);
+};
+
+/**
+ * Position of a spendable Lelantus mint in the tracker's amount index: by amount,
+ * then by height so that older mints of the same amount come first.
+ */
+struct CLelantusAmountIndexKey
+{
+    CAmount amount;
+    int nHeight;
+    uint256 hashSerial;
+
+    bool operator<(const CLelantusAmountIndexKey& other) const {
+        return std::tie(amount, nHeight, hashSerial) < std::tie(other.amount, other.nHeight, other.hashSerial);
+    }
+};
+
 class CHDMintTracker
 {
 private:
@@ -21,6 +54,17 @@ private:
     std::map<uint256, CMintMeta> mapSerialHashes;
     std::map<uint256, CLelantusMintMeta> mapLelantusSerialHashes;
     std::map<uint256, uint256> mapPendingSpends; //serialhash, txid of spend
+    // Balances of the mints in mapSerialHashes and mapLelantusSerialHashes, every
+    // write to those maps goes through SetMeta so the totals never need a full walk
+    CPrivateBalance sigmaBalance;
+    CPrivateBalance lelantusBalance;
+    void SetMeta(const CMintMeta& meta);
+    void SetMeta(const CLelantusMintMeta& meta);
+    void UpdateBalance(const CMintMeta& meta, bool fAdd);
+    void UpdateBalance(const CLelantusMintMeta& meta, bool fAdd);
+    // Confirmed, unused, non zero Lelantus mints ordered by amount, kept by SetMeta
+    std::set<CLelantusAmountIndexKey> setLelantusAmountIndex;
+    static bool IsInAmountIndex(const CLelantusMintMeta& meta);
     bool IsMempoolSpendOurs(const std::set<uint256>& setMempool, const uint256& hashSerial);
     bool UpdateMetaStatus(const std::set<uint256>& setMempool, CMintMeta& mint, bool fSpend=false);
     bool UpdateLelantusMetaStatus(const std::set<uint256>& setMempool, CLelantusMintMeta& mint, bool fSpend=false);
@@ -38,6 +82,7 @@ public:
     bool HasSerialHash(const uint256& hashSerial) const;
     bool HasLelantusSerialHash(const uint256& hashSerial) const;
     bool IsEmpty() const { return mapSerialHashes.empty(); }
+    CPrivateBalance GetPrivateBalance() const;
     void Init();
     bool GetMetaFromSerial(const uint256& hashSerial, CMintMeta& mMeta);
     bool GetMetaFromSerial(const uint256& hashSerial, CLelantusMintMeta& mMeta);
@@ -58,6 +103,7 @@ public:
     std::list<CSigmaEntry> MintsAsSigmaEntries(bool fUnusedOnly = true, bool fMatureOnly = true);
     std::list<CLelantusEntry> MintsAsLelantusEntries(bool fUnusedOnly = true, bool fMatureOnly = true);
     std::vector<CMintMeta> ListMints(bool fUnusedOnly = true, bool fMatureOnly = true, bool fUpdateStatus = true, bool fLoad = false, bool fWrongSeed = false);
+    std::vector<CLelantusMintMeta> SelectLelantusMints(CAmount required, const std::function<bool(const CLelantusMintMeta&)>& isSpendable) const;
     std::vector<CLelantusMintMeta> ListLelantusMints(bool fUnusedOnly = true, bool fMatureOnly = true, bool fUpdateStatus = true, bool fLoad = false, bool fWrongSeed = false);
     void SetPubcoinUsed(const uint256& hashPubcoin, const uint256& txid);
     void SetPubcoinNotUsed(const uint256& hashPubcoin);
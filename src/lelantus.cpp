@@ -523,11 +523,16 @@ bool CheckLelantusJoinSplitTransaction(
     }
 
     BatchProofContainer* batchProofContainer = BatchProofContainer::get_instance();
-    bool useBatching = batchProofContainer->fCollectProofs && !isVerifyDB && !isCheckWallet && lelantusTxInfo && !lelantusTxInfo->fInfoIsComplete;
+    // proofs already verified in this context on this tip need not be verified again
+    bool fProofVerified = !isVerifyDB && !isCheckWallet && IsPrivacyProofVerified(hashTx, nHeight);
+    bool useBatching = !fProofVerified && batchProofContainer->fCollectProofs && !isVerifyDB && !isCheckWallet && lelantusTxInfo && !lelantusTxInfo->fInfoIsComplete;
 
     Scalar challenge;
     // if we are collecting proofs, skip verification and collect proofs
-    passVerify = joinsplit->Verify(anonymity_sets, anonymity_set_hashes, Cout, Vout, txHashForMetadata, challenge, useBatching);
+    passVerify = joinsplit->Verify(anonymity_sets, anonymity_set_hashes, Cout, Vout, txHashForMetadata, challenge, useBatching || fProofVerified);
+
+    if (passVerify && !useBatching && !fProofVerified && !isVerifyDB && !isCheckWallet)
+        SetPrivacyProofVerified(hashTx, nHeight);
 
     // add proofs into container
     if(useBatching) {
@@ -689,16 +689,19 @@ void CInstantSendManager::HandleNewInstantSendLockRecoveredSig(const llmq::CReco
     ProcessInstantSendLock(-1, ::SerializeHash(islock), islock);
 }
 
-void CInstantSendManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
+void CInstantSendManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, const CDecodedPayload& decoded, CConnman& connman)
 {
     if (!IsNewInstantSendEnabled()) {
         return;
     }
 
     if (strCommand == NetMsgType::ISLOCK) {
-        CInstantSendLock islock;
-        vRecv >> islock;
-        ProcessMessageInstantSendLock(pfrom, islock, connman);
+        auto islock = decoded.Get<CInstantSendLock>();
+        if (!islock) {
+            islock = std::make_shared<CInstantSendLock>();
+            vRecv >> *islock;
+        }
+        ProcessMessageInstantSendLock(pfrom, *islock, connman);
     }
 }
 
@@ -131,7 +131,7 @@ public:
     void UpdatedBlockTip(const CBlockIndex* pindexNew);
 
     void NotifyChainLock(const CBlockIndex* pindexChainLock);
-    void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
+    void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, const CDecodedPayload& decoded, CConnman& connman);
     size_t GetInstantSendLockCount();
     bool AlreadyHave(const CInv& inv);
 
@@ -1255,6 +1255,55 @@ void GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainpar
         minerThreads->create_thread(boost::bind(&FiroMiner, boost::cref(chainparams)));
 }
 
+CBlockTemplateCache blockTemplateCache;
+
+CBlockTemplateCache::CBlockTemplateCache()
+    : pindexPrev(nullptr), fMineWitnessTx(true), nTransactionsUpdated(0), nTimeCreated(0)
+{
+}
+
+const CBlockTemplate* CBlockTemplateCache::Get(const CChainParams& chainparams, const CScript& scriptPubKeyIn, bool fMineWitnessTxIn, bool& fNew)
+{
+    AssertLockHeld(cs_main);
+
+    fNew = false;
+    bool fSameTip = pblocktemplate && pindexPrev == chainActive.Tip() &&
+            scriptPubKey == scriptPubKeyIn && fMineWitnessTx == fMineWitnessTxIn;
+    if (fSameTip && (mempool.GetTransactionsUpdated() == nTransactionsUpdated || GetTime() - nTimeCreated <= BLOCK_TEMPLATE_REFRESH_INTERVAL))
+        return pblocktemplate.get();
+
+    // Clear pindexPrev so a failure below does not leave the old template looking current
+    pblocktemplate.reset();
+    pindexPrev = nullptr;
+
+    // Store the tip and update counter before CreateNewBlock, to avoid races
+    unsigned int nTransactionsUpdatedNew = mempool.GetTransactionsUpdated();
+    CBlockIndex* pindexPrevNew = chainActive.Tip();
+    int64_t nTimeStart = GetTimeMicros();
+
+    pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKeyIn, fMineWitnessTxIn);
+    if (!pblocktemplate)
+        return nullptr;
+
+    LogPrint("bench", "CBlockTemplateCache: %s template for height %d in %.2fms\n", fSameTip ? "rebuilt" : "new",
+             pindexPrevNew->nHeight + 1, 0.001 * (GetTimeMicros() - nTimeStart));
+
+    // Need to update only after we know CreateNewBlock succeeded
+    pindexPrev = pindexPrevNew;
+    scriptPubKey = scriptPubKeyIn;
+    fMineWitnessTx = fMineWitnessTxIn;
+    nTransactionsUpdated = nTransactionsUpdatedNew;
+    nTimeCreated = GetTime();
+    fNew = true;
+    return pblocktemplate.get();
+}
+
+void CBlockTemplateCache::Clear()
+{
+    pblocktemplate.reset();
+    pindexPrev = nullptr;
+}
+
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
 {
     // Update nExtraNonce
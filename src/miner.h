@@ -26,6 +26,8 @@ static const bool DEFAULT_GENERATE = false;
 static const int DEFAULT_GENERATE_THREADS = 1;
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Seconds a cached getblocktemplate template is served before mempool changes are picked up */
+static const int64_t BLOCK_TEMPLATE_REFRESH_INTERVAL = 5;
 
 struct CBlockTemplate
 {
@@ -230,6 +232,43 @@ private:
     void FillBlackListForBlockTemplate();
 };
 
+/**
+ * The block template served by getblocktemplate. A template is kept for the
+ * current tip and handed out until the tip changes, or until the mempool has
+ * changed and the template is older than BLOCK_TEMPLATE_REFRESH_INTERVAL.
+ * A stale template is rebuilt from scratch with CreateNewBlock; only the
+ * Sigma/Lelantus proofs already verified for a block on this tip are not
+ * verified again (see IsPrivacyProofVerified). Callers must hold cs_main.
+ */
+class CBlockTemplateCache
+{
+private:
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    CBlockIndex* pindexPrev;
+    CScript scriptPubKey;
+    bool fMineWitnessTx;
+    unsigned int nTransactionsUpdated;
+    int64_t nTimeCreated;
+
+public:
+    CBlockTemplateCache();
+
+    /** Return the current template, assembling a new one if it is stale. fNew is
+     *  set when the template changed. Returns nullptr if CreateNewBlock does. */
+    const CBlockTemplate* Get(const CChainParams& chainparams, const CScript& scriptPubKeyIn, bool fMineWitnessTxIn, bool& fNew);
+
+    /** Tip the current template was built on */
+    CBlockIndex* GetPrev() const { return pindexPrev; }
+
+    /** Mempool update counter the current template was built at */
+    unsigned int GetTransactionsUpdated() const { return nTransactionsUpdated; }
+
+    /** Drop the current template */
+    void Clear();
+};
+
+extern CBlockTemplateCache blockTemplateCache;
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
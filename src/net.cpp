@@ -29,11 +29,17 @@
 #include "masternode-sync.h"
 #include "llmq/quorums_instantsend.h"
 #include "evo/mnauth.h"
+#include "ctpl.h"
 
 #ifdef WIN32
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
 #endif
 
 #ifdef USE_UPNP
@@ -86,11 +92,24 @@ constexpr const CConnman::CAllNodes CConnman::AllNodes;
 const static std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
 static const uint64_t RANDOMIZER_ID_LOCALHOSTNONCE = 0xd93e69e2bbfa5735ULL; // SHA256("localhostnonce")[0:8]
+static const uint64_t RANDOMIZER_ID_ADDRCACHE = 0x1cf2e4ddd306dda9ULL; // SHA256("addrcache")[0:8]
+static const int SOCKET_EVENTS_TIMEOUT_MS = 50; // frequency to poll pnode->vSend
+
+// Commands whose payload is expensive enough to deserialize on the decode workers;
+// each one needs a matching case in DecodeMessage (net_processing.cpp)
+static const std::set<std::string> DECODED_MESSAGE_TYPES = {
+    NetMsgType::TX,
+    NetMsgType::DANDELIONTX,
+    NetMsgType::BLOCK,
+    NetMsgType::ISLOCK,
+};
 
 // Public Dandelion fields.
 
-// All transactions embargoed by dandelion.
-std::map<uint256, int64_t> CNode::mDandelionEmbargo;
+// All transactions embargoed by dandelion, by hash and by expiry.
+CCriticalSection CNode::cs_dandelionEmbargo;
+std::unordered_map<uint256, int64_t, StaticSaltedHasher> CNode::mDandelionEmbargo;
+std::priority_queue<CNode::DandelionEmbargo, std::vector<CNode::DandelionEmbargo>, std::greater<CNode::DandelionEmbargo>> CNode::queueDandelionEmbargo;
 
 // Inbound connections. Transactions from each connection
 // are broadcast to one of 2 dandelion destinations.
@@ -413,7 +432,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
+        if (socketEventsMode == SOCKETEVENTS_SELECT && !IsSelectableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -907,27 +926,58 @@ size_t CConnman::SocketSendData(CNode *pnode) const
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert(it->size() > pnode->nSendOffset);
         int nBytes = 0;
+        size_t nBatchSize = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            nBatchSize = it->size() - pnode->nSendOffset;
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(it->data()) + pnode->nSendOffset, nBatchSize, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            // Hand the queued buffers (a header and a payload per message) to the
+            // kernel in one call, so floods of small messages cost one syscall
+            struct iovec vecs[MAX_SEND_BATCH_BUFFERS];
+            size_t nVecs = 0;
+            size_t nOffset = pnode->nSendOffset;
+            for (auto jt = it; jt != pnode->vSendMsg.end() && nVecs < MAX_SEND_BATCH_BUFFERS && nBatchSize < MAX_SEND_BATCH_SIZE; ++jt) {
+                vecs[nVecs].iov_base = const_cast<unsigned char*>(jt->data()) + nOffset;
+                vecs[nVecs].iov_len = jt->size() - nOffset;
+                nBatchSize += vecs[nVecs].iov_len;
+                nOffset = 0;
+                nVecs++;
+            }
+            struct msghdr msg = {};
+            msg.msg_iov = vecs;
+            msg.msg_iovlen = nVecs;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
+            // A short or failed send means the socket buffer is full; wait for the next EPOLLOUT edge
+            if (nBytes < (int)nBatchSize)
+                pnode->fCanSendData = false;
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // Retire the buffers that went out completely, remember how far into the next one we got
+            size_t nLeft = nBytes;
+            while (nLeft > 0) {
+                size_t nRemaining = it->size() - pnode->nSendOffset;
+                if (nLeft < nRemaining) {
+                    pnode->nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nRemaining;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= it->size();
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < nBatchSize) {
+                // could not send the whole batch; stop sending more
                 break;
             }
         } else {
@@ -1224,7 +1274,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (socketEventsMode == SOCKETEVENTS_SELECT && !IsSelectableSocket(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1260,7 +1310,15 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     NodeId id = GetNewNodeId();
     uint64_t nonce = GetDeterministicRandomizer(RANDOMIZER_ID_LOCALHOSTNONCE).Write(id).Finalize();
 
-    CNode* pnode = new CNode(id, nLocalServices, GetBestHeight(), hSocket, addr, CalculateKeyedNetGroup(addr), nonce, "", true);
+    CAddress addrBind;
+    struct sockaddr_storage sockaddrBind;
+    socklen_t lenBind = sizeof(sockaddrBind);
+    if (getsockname(hSocket, (struct sockaddr*)&sockaddrBind, &lenBind) == 0)
+        addrBind.SetSockAddr((const struct sockaddr*)&sockaddrBind);
+    else
+        LogPrint("net", "getsockname failed for connection from %s\n", addr.ToString());
+
+    CNode* pnode = new CNode(id, nLocalServices, GetBestHeight(), hSocket, addr, CalculateKeyedNetGroup(addr), nonce, "", true, addrBind);
     pnode->AddRef();
     pnode->fWhitelisted = whitelisted;
     GetNodeSignals().InitializeNode(pnode, *this);
@@ -1269,6 +1327,11 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
 
     {
         LOCK(cs_vNodes);
+        // Still added on failure, so the usual disconnect path cleans the node up
+        if (!RegisterEvents(pnode)) {
+            vNodes.push_back(pnode);
+            return;
+        }
         vNodes.push_back(pnode);
         // Dandelion: new inbound connection
         CNode::vDandelionInbound.push_back(pnode);
@@ -1359,9 +1422,231 @@ void CNode::CloseDandelionConnections(const CNode* const pnode)
     }
 }
 
+void CNetMsgStats::Histogram::Add(int64_t nValue)
+{
+    nCount++;
+    nSum += nValue;
+    nMax = std::max(nMax, nValue);
+    int nBucket = nValue > 0 ? CountBits(nValue) : 0;
+    vBuckets[std::min(nBucket, HISTOGRAM_BUCKETS - 1)]++;
+}
+
+CNetMsgStats::CNetMsgStats()
+{
+    for (const std::string &msg : getAllNetMessageTypes())
+        mapStats[msg];
+    mapStats[NET_MESSAGE_COMMAND_OTHER];
+}
+
+CNetMsgStats::Entry& CNetMsgStats::GetEntry(const std::string& strCommand)
+{
+    auto it = mapStats.find(strCommand);
+    if (it == mapStats.end())
+        it = mapStats.find(NET_MESSAGE_COMMAND_OTHER);
+    assert(it != mapStats.end());
+    return it->second;
+}
+
+void CNetMsgStats::RecordDecode(const std::string& strCommand, int64_t nMicros)
+{
+    LOCK(cs_stats);
+    GetEntry(strCommand).decode.Add(nMicros);
+}
+
+void CNetMsgStats::RecordProcess(const std::string& strCommand, size_t nSize, int64_t nQueueMicros, int64_t nProcessMicros)
+{
+    LOCK(cs_stats);
+    Entry& entry = GetEntry(strCommand);
+    entry.size.Add(nSize);
+    entry.queue.Add(nQueueMicros);
+    entry.process.Add(nProcessMicros);
+}
+
+std::map<std::string, CNetMsgStats::Entry> CNetMsgStats::GetStats() const
+{
+    LOCK(cs_stats);
+    return mapStats;
+}
+
+void CConnman::StartDecodingMessage(CNode *pnode, CNetMessage &msg)
+{
+    // The stream version is only final once the handshake is done
+    if (!messageDecodePool || !pnode->fSuccessfullyConnected)
+        return;
+    if (!DECODED_MESSAGE_TYPES.count(msg.hdr.GetCommand()))
+        return;
+
+    msg.SetVersion(pnode->GetRecvVersion());
+    // std::list keeps the message in place when it is spliced into vProcessMsg, and
+    // ~CNetMessage waits for the worker, so the pointer outlives the job. The worker
+    // reads a copy, leaving vRecv intact for the handler (sizes, logging, fallback).
+    CNetMessage *pmsg = &msg;
+    msg.decoding = messageDecodePool->push([this, pmsg](int) {
+        int64_t nStart = GetTimeMicros();
+        CDataStream vRecv(pmsg->vRecv.begin(), pmsg->vRecv.end(), pmsg->vRecv.GetType(), pmsg->vRecv.GetVersion());
+        GetNodeSignals().DecodeMessage(pmsg->hdr.GetCommand(), vRecv, pmsg->decoded);
+        msgStats.RecordDecode(pmsg->hdr.GetCommand(), GetTimeMicros() - nStart);
+    }).share();
+}
+
+bool CConnman::RegisterEvents(CNode *pnode)
+{
+#ifdef USE_EPOLL
+    if (socketEventsMode != SOCKETEVENTS_EPOLL)
+        return true;
+
+    LOCK(pnode->cs_hSocket);
+    assert(pnode->hSocket != INVALID_SOCKET);
+
+    epoll_event e;
+    // Edge-triggered: every readiness change is reported once, and the node
+    // keeps it in fHasRecvData/fCanSendData until it has been used up
+    e.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    e.data.fd = pnode->hSocket;
+
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &e) != 0) {
+        LogPrintf("Failed to add socket of peer=%d to epoll: %s, disconnecting\n", pnode->id, NetworkErrorString(WSAGetLastError()));
+        pnode->fDisconnect = true;
+        return false;
+    }
+#endif
+    return true;
+}
+
+void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, int nTimeoutMs)
+{
+#ifdef USE_EPOLL
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        SocketEventsEpoll(recv_set, send_set, error_set, nTimeoutMs);
+        return;
+    }
+#endif
+    SocketEventsSelect(recv_set, send_set, error_set, nTimeoutMs);
+}
+
+#ifdef USE_EPOLL
+void CConnman::SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, int nTimeoutMs)
+{
+    // Closed sockets leave the epoll set by themselves, so there is nothing to
+    // rebuild here: the cost of a wait only depends on how many sockets are ready
+    epoll_event events[MAX_SOCKET_EVENTS];
+    int nEvents = epoll_wait(epollfd, events, MAX_SOCKET_EVENTS, nTimeoutMs);
+    if (nEvents < 0) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("epoll_wait error %s\n", NetworkErrorString(nErr));
+            interruptNet.sleep_for(std::chrono::milliseconds(nTimeoutMs));
+        }
+        return;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        const epoll_event &e = events[i];
+        if (e.events & (EPOLLERR | EPOLLHUP)) {
+            error_set.insert(e.data.fd);
+        }
+        if (e.events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) {
+            recv_set.insert(e.data.fd);
+        }
+        if (e.events & EPOLLOUT) {
+            send_set.insert(e.data.fd);
+        }
+    }
+}
+#endif
+
+void CConnman::SocketEventsSelect(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, int nTimeoutMs)
+{
+    struct timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = nTimeoutMs * 1000;
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    std::vector<SOCKET> vSelected;
+
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+        FD_SET(hListenSocket.socket, &fdsetRecv);
+        hSocketMax = std::max(hSocketMax, hListenSocket.socket);
+        vSelected.push_back(hListenSocket.socket);
+    }
+
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes)
+        {
+            // Implement the following logic:
+            // * If there is data to send, select() for sending data. As this only
+            //   happens when optimistic write failed, we choose to first drain the
+            //   write buffer in this case before receiving more. This avoids
+            //   needlessly queueing received data, if the remote peer is not themselves
+            //   receiving data. This means properly utilizing TCP flow control signalling.
+            // * Otherwise, if there is space left in the receive buffer, select() for
+            //   receiving data.
+            // * Hand off all complete messages to the processor, to be handled without
+            //   blocking here.
+
+            bool select_recv = !pnode->fPauseRecv;
+            bool select_send;
+            {
+                LOCK(pnode->cs_vSend);
+                select_send = !pnode->vSendMsg.empty();
+            }
+
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+
+            FD_SET(pnode->hSocket, &fdsetError);
+            hSocketMax = std::max(hSocketMax, pnode->hSocket);
+            vSelected.push_back(pnode->hSocket);
+
+            if (select_send) {
+                FD_SET(pnode->hSocket, &fdsetSend);
+                continue;
+            }
+            if (select_recv) {
+                FD_SET(pnode->hSocket, &fdsetRecv);
+            }
+        }
+    }
+
+    int nSelect = select(vSelected.empty() ? 0 : hSocketMax + 1,
+                         &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (interruptNet)
+        return;
+
+    if (nSelect == SOCKET_ERROR)
+    {
+        if (!vSelected.empty())
+        {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            recv_set.insert(vSelected.begin(), vSelected.end());
+        }
+        interruptNet.sleep_for(std::chrono::milliseconds(nTimeoutMs));
+        return;
+    }
+
+    for (SOCKET hSocket : vSelected) {
+        if (FD_ISSET(hSocket, &fdsetRecv))
+            recv_set.insert(hSocket);
+        if (FD_ISSET(hSocket, &fdsetSend))
+            send_set.insert(hSocket);
+        if (FD_ISSET(hSocket, &fdsetError))
+            error_set.insert(hSocket);
+    }
+}
+
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    bool fMoreData = false;
     while (!interruptNet)
     {
         //
@@ -1431,91 +1716,20 @@ void CConnman::ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
-
-        {
-            LOCK(cs_vNodes);
-            BOOST_FOREACH(CNode* pnode, vNodes)
-            {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-
-                bool select_recv = !pnode->fPauseRecv;
-                bool select_send;
-                {
-                    LOCK(pnode->cs_vSend);
-                    select_send = !pnode->vSendMsg.empty();
-                }
-
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
-            }
-        }
-
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        std::set<SOCKET> recv_set, send_set, error_set;
+        // Edge-triggered epoll only reports new readiness, so don't block while
+        // a node still has data buffered in the kernel from the last round
+        SocketEvents(recv_set, send_set, error_set, fMoreData ? 0 : SOCKET_EVENTS_TIMEOUT_MS);
         if (interruptNet)
             return;
-
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
-                return;
-        }
+        fMoreData = false;
 
         //
         // Accept new connections
         //
         BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && recv_set.count(hListenSocket.socket))
             {
                 AcceptConnection(hListenSocket);
             }
@@ -1542,13 +1756,31 @@ void CConnman::ThreadSocketHandler()
             bool recvSet = false;
             bool sendSet = false;
             bool errorSet = false;
-            {
+            if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+                // Readiness persists on the node until recv()/send() use it up; apply the
+                // same drain-sends-first policy as the select() path
+                bool fSendPending;
+                {
+                    LOCK(pnode->cs_vSend);
+                    fSendPending = !pnode->vSendMsg.empty();
+                }
                 LOCK(pnode->cs_hSocket);
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+                if (recv_set.count(pnode->hSocket))
+                    pnode->fHasRecvData = true;
+                if (send_set.count(pnode->hSocket))
+                    pnode->fCanSendData = true;
+                sendSet = fSendPending && pnode->fCanSendData;
+                recvSet = !fSendPending && pnode->fHasRecvData && !pnode->fPauseRecv;
+                errorSet = error_set.count(pnode->hSocket);
+            } else {
+                LOCK(pnode->cs_hSocket);
+                if (pnode->hSocket == INVALID_SOCKET)
+                    continue;
+                recvSet = recv_set.count(pnode->hSocket);
+                sendSet = send_set.count(pnode->hSocket);
+                errorSet = error_set.count(pnode->hSocket);
             }
             if (recvSet || errorSet)
             {
@@ -1562,6 +1794,11 @@ void CConnman::ThreadSocketHandler()
                             if (pnode->hSocket == INVALID_SOCKET)
                                 continue;
                             nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+                            // A full buffer may leave more data behind, which epoll won't report again
+                            if (nBytes == (int)sizeof(pchBuf))
+                                fMoreData = true;
+                            else
+                                pnode->fHasRecvData = false;
                         }
                         if (nBytes > 0)
                         {
@@ -1576,6 +1813,7 @@ void CConnman::ThreadSocketHandler()
                                     if (!it->complete())
                                         break;
                                     nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+                                    StartDecodingMessage(pnode, *it);
                                 }
                                 {
                                     LOCK(pnode->cs_vProcessMsg);
@@ -2320,12 +2558,15 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         pnode->fAddnode = true;
 
     GetNodeSignals().InitializeNode(pnode, *this);
+    bool fRegistered;
     {
         LOCK(cs_vNodes);
+        // Still added on failure, so the usual disconnect path cleans the node up
+        fRegistered = RegisterEvents(pnode);
         vNodes.push_back(pnode);
     }
 
-    return true;
+    return fRegistered;
 }
 
 bool CConnman::OpenMasternodeConnection(const CAddress &addrConnect) {
@@ -2652,6 +2893,8 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     nBestHeight = 0;
     clientInterface = NULL;
     flagInterruptMsgProc = false;
+    socketEventsMode = SOCKETEVENTS_SELECT;
+    epollfd = -1;
 }
 
 NodeId CConnman::GetNewNodeId()
@@ -2679,6 +2922,47 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     nMaxOutboundLimit = connOptions.nMaxOutboundLimit;
     nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
 
+    socketEventsMode = connOptions.socketEventsMode;
+#ifdef USE_EPOLL
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            LogPrintf("Failed to create epoll instance: %s, falling back to select()\n", NetworkErrorString(WSAGetLastError()));
+            socketEventsMode = SOCKETEVENTS_SELECT;
+
+            // init only applied the FD_SETSIZE limit of select() when it was asked for
+            int nBind = std::max(vhListenSocket.size(), size_t(1));
+            int nMaxSelectConnections = std::max((int)FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS, 0);
+            if (nMaxConnections > nMaxSelectConnections) {
+                LogPrintf("Reducing -maxconnections from %d to %d for select()\n", nMaxConnections, nMaxSelectConnections);
+                nMaxConnections = nMaxSelectConnections;
+                nMaxOutbound = std::min(nMaxOutbound, nMaxConnections);
+            }
+        }
+    }
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        // Listen sockets stay level-triggered so a backlog of pending connections
+        // keeps being reported until every one of them has been accepted
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+            epoll_event e;
+            e.events = EPOLLIN;
+            e.data.fd = hListenSocket.socket;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hListenSocket.socket, &e) != 0) {
+                strNodeError = strprintf("Failed to add listen socket to epoll: %s", NetworkErrorString(WSAGetLastError()));
+                return false;
+            }
+        }
+    }
+#else
+    socketEventsMode = SOCKETEVENTS_SELECT;
+#endif
+    LogPrintf("Using %s for socket events\n", socketEventsMode == SOCKETEVENTS_EPOLL ? "epoll" : "select");
+
+    if (connOptions.nMessageDecodeThreads > 0) {
+        messageDecodePool.reset(new ctpl::thread_pool(connOptions.nMessageDecodeThreads));
+        RenameThreadPool(*messageDecodePool, "firo-msgdecode");
+    }
+
     SetBestHeight(connOptions.nBestHeight);
 
     clientInterface = connOptions.uiInterface;
@@ -2771,6 +3055,9 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     // Dump network addresses
     scheduler.scheduleEvery(boost::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL);
 
+    // Fluff Dandelion transactions whose embargo ran out
+    scheduler.scheduleEvery(&CNode::CheckDandelionEmbargoes, DANDELION_EMBARGO_CHECK_INTERVAL);
+
     return true;
 }
 
@@ -2843,6 +3130,12 @@ void CConnman::Stop()
         fAddressesInitialized = false;
     }
 
+    // Finish pending decodes, the nodes deleted below own the messages they work on
+    if (messageDecodePool) {
+        messageDecodePool->stop(true);
+        messageDecodePool.reset();
+    }
+
     // Close sockets
     BOOST_FOREACH(CNode* pnode, vNodes)
         pnode->CloseSocketDisconnect();
@@ -2850,6 +3143,12 @@ void CConnman::Stop()
         if (hListenSocket.socket != INVALID_SOCKET)
             if (!CloseSocket(hListenSocket.socket))
                 LogPrintf("CloseSocket(hListenSocket) failed with error %s\n", NetworkErrorString(WSAGetLastError()));
+#ifdef USE_EPOLL
+    if (epollfd != -1) {
+        close(epollfd);
+        epollfd = -1;
+    }
+#endif
 
     // clean up some globals (to help leak detection)
     BOOST_FOREACH(CNode *pnode, vNodes) {
@@ -2910,9 +3209,23 @@ void CConnman::AddNewAddresses(const std::vector<CAddress>& vAddr, const CAddres
     addrman.Add(vAddr, addrFrom, nTimePenalty);
 }
 
-std::vector<CAddress> CConnman::GetAddresses()
+std::vector<CAddress> CConnman::GetAddresses(const CNode* pnode)
 {
-    return addrman.GetAddr();
+    std::vector<unsigned char> vchLocal = pnode->addrBind.GetKey();
+    uint64_t nCacheId = GetDeterministicRandomizer(RANDOMIZER_ID_ADDRCACHE)
+        .Write(pnode->addr.GetNetwork())
+        .Write(vchLocal.data(), vchLocal.size())
+        .Finalize();
+
+    int64_t nNow = GetTime();
+    LOCK(cs_mapAddrResponseCache);
+    CachedAddrResponse& cache = mapAddrResponseCache[nCacheId];
+    if (cache.nExpire <= nNow) {
+        cache.vAddr = addrman.GetAddr();
+        // A random expiry keeps peers from telling when the sample is refreshed
+        cache.nExpire = nNow + GETADDR_RESPONSE_CACHE_TIME + GetRand(GETADDR_RESPONSE_CACHE_TIME / 2);
+    }
+    return cache.vAddr;
 }
 
 bool CConnman::AddNode(const std::string& strNode)
@@ -2980,45 +3293,57 @@ void CNode::RelayDandelionTransaction(const CTransaction& tx, CNode* pfrom)
 
 void CNode::CheckDandelionEmbargoes()
 {
-    int64_t nCurrTime = GetTimeMicros();
-    for (auto iter=mDandelionEmbargo.begin(); iter != mDandelionEmbargo.end();) {
-        // If we got the embargoed transaction back, erase it.
-        if (mempool.exists(iter->first)) {
-           iter = mDandelionEmbargo.erase(iter);
-        } else if (iter->second < nCurrTime) {
-            // Embargo time is over, we did not "see" the transaction back in fluff phase,
-            // so start fluffing/relaying it.
-            CValidationState state;
-            std::shared_ptr<const CTransaction> ptx = txpools.getStemTxPool().get(iter->first);
-            // If txn was not found in Stempool, then something went wrong,
-            // Keep it embargoed for now.
-            if (!ptx) {
-               iter = mDandelionEmbargo.erase(iter);
-                continue;
+    // Only the embargoes that came due are touched, earliest first off the heap
+    std::vector<uint256> vExpired;
+    {
+        LOCK(cs_dandelionEmbargo);
+        int64_t nCurrTime = GetTimeMicros();
+        while (!queueDandelionEmbargo.empty() && queueDandelionEmbargo.top().first < nCurrTime) {
+            const DandelionEmbargo& embargo = queueDandelionEmbargo.top();
+            auto iter = mDandelionEmbargo.find(embargo.second);
+            // Skip embargoes that were lifted or replaced in the meantime
+            if (iter != mDandelionEmbargo.end() && iter->second == embargo.first) {
+                vExpired.push_back(embargo.second);
+                mDandelionEmbargo.erase(iter);
             }
-            bool fMissingInputs = false;
-            std::list<CTransactionRef> lRemovedTxn;
-            AcceptToMemoryPool(
-                mempool,
-                state,
-                ptx,
-                true, // fLimitFree
-                &fMissingInputs,
-                &lRemovedTxn,
-                false, /* fOverrideMempoolLimit */
-                0, /* nAbsurdFee */
-                false /*isCheckWalletTransaction*/
-                );
-            LogPrintf("AcceptToMemoryPool: accepted %s (poolsz %u txn, %u kB)\n",
-                      iter->first.ToString(),
-                      mempool.size(),
-                      mempool.DynamicMemoryUsage() / 1000);
-            g_connman->RelayTransaction(*ptx);
-            iter = mDandelionEmbargo.erase(iter);
-        } else {
-            iter++;
+            queueDandelionEmbargo.pop();
         }
     }
+    if (vExpired.empty())
+        return;
+
+    LOCK(cs_main);
+    for (const uint256& hash : vExpired) {
+        // If we got the embargoed transaction back, there is nothing to do.
+        if (mempool.exists(hash))
+            continue;
+        // Embargo time is over, we did not "see" the transaction back in fluff phase,
+        // so start fluffing/relaying it.
+        CValidationState state;
+        std::shared_ptr<const CTransaction> ptx = txpools.getStemTxPool().get(hash);
+        // If txn was not found in Stempool, then something went wrong.
+        if (!ptx)
+            continue;
+        bool fMissingInputs = false;
+        std::list<CTransactionRef> lRemovedTxn;
+        AcceptToMemoryPool(
+            mempool,
+            state,
+            ptx,
+            true, // fLimitFree
+            &fMissingInputs,
+            &lRemovedTxn,
+            false, /* fOverrideMempoolLimit */
+            0, /* nAbsurdFee */
+            false /*isCheckWalletTransaction*/
+            );
+        LogPrintf("AcceptToMemoryPool: accepted %s (poolsz %u txn, %u kB)\n",
+                  hash.ToString(),
+                  mempool.size(),
+                  mempool.DynamicMemoryUsage() / 1000);
+        if (g_connman)
+            g_connman->RelayTransaction(*ptx);
+    }
 }
 
 bool CConnman::RemoveAddedNode(const std::string& strNode)
@@ -3363,11 +3688,12 @@ int CConnman::GetBestHeight() const
 unsigned int CConnman::GetReceiveFloodSize() const { return nReceiveFloodSize; }
 unsigned int CConnman::GetSendBufferSize() const{ return nSendBufferMaxSize; }
 
-CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn, SOCKET hSocketIn, const CAddress& addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const std::string& addrNameIn, bool fInboundIn) :
+CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn, SOCKET hSocketIn, const CAddress& addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const std::string& addrNameIn, bool fInboundIn, const CAddress& addrBindIn) :
     nTimeConnected(GetSystemTimeInSeconds()),
     nTimeFirstMessageReceived(0),
     fFirstMessageIsMNAUTH(false),
     addr(addrIn),
+    addrBind(addrBindIn),
     fInbound(fInboundIn),
     id(idIn),
     nKeyedNetGroup(nKeyedNetGroupIn),
@@ -3428,6 +3754,8 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     fZnode = false;
     fPauseRecv = false;
     fPauseSend = false;
+    fHasRecvData = false;
+    fCanSendData = true;
     nProcessQueueSize = 0;
     pendingMNVerification = nullptr;
 
@@ -3656,15 +3984,20 @@ bool CNode::localDandelionDestinationPushInventory(const CInv& inv) {
 }
 
 bool CNode::insertDandelionEmbargo(const uint256& hash, const int64_t& embargo) {
+    LOCK(cs_dandelionEmbargo);
     auto pair = mDandelionEmbargo.insert(std::make_pair(hash, embargo));
+    if (pair.second)
+        queueDandelionEmbargo.push(std::make_pair(embargo, hash));
     return pair.second;
 }
 
 bool CNode::isTxDandelionEmbargoed(const uint256& hash) {
+    LOCK(cs_dandelionEmbargo);
     return mDandelionEmbargo.find(hash) != mDandelionEmbargo.end();
 }
 
 bool CNode::removeDandelionEmbargo(const uint256& hash) {
+    LOCK(cs_dandelionEmbargo);
     auto iter = mDandelionEmbargo.find(hash);
     if (iter != mDandelionEmbargo.end()) {
         mDandelionEmbargo.erase(iter);
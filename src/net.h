@@ -16,6 +16,7 @@
 #include "netaddress.h"
 #include "protocol.h"
 #include "random.h"
+#include "saltedhasher.h"
 #include "streams.h"
 #include "sync.h"
 #include "uint256.h"
@@ -26,10 +27,14 @@
 
 #include <atomic>
 #include <deque>
+#include <queue>
 #include <stdint.h>
 #include <thread>
 #include <memory>
 #include <condition_variable>
+#include <exception>
+#include <future>
+#include <unordered_map>
 
 #ifndef WIN32
 #include <arpa/inet.h>
@@ -82,6 +87,16 @@ static const unsigned int MAX_SUBVERSION_LENGTH = 256;
 static const int MAX_OUTBOUND_CONNECTIONS = 8;
 /** Maximum number of addnode outgoing nodes */
 static const int MAX_ADDNODE_CONNECTIONS = 8;
+
+#ifdef WIN32
+// Win32 LevelDB doesn't use filedescriptors, and the ones used for
+// accessing block files don't count towards the fd_set size limit
+// anyway.
+#define MIN_CORE_FILEDESCRIPTORS 0
+#else
+#define MIN_CORE_FILEDESCRIPTORS 150
+#endif
+
 /** Maximum number if outgoing masternodes */
 static const int MAX_OUTBOUND_MASTERNODE_CONNECTIONS = 30;
 static const int MAX_OUTBOUND_MASTERNODE_CONNECTIONS_ON_MN = 250;
@@ -114,6 +129,32 @@ static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
 static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 
+/** How the socket handler waits for socket readiness */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT = 0,
+    SOCKETEVENTS_EPOLL = 1,
+};
+/** The default for -socketevents */
+#ifdef USE_EPOLL
+static const char* const DEFAULT_SOCKETEVENTS = "epoll";
+#else
+static const char* const DEFAULT_SOCKETEVENTS = "select";
+#endif
+/** Maximum number of readiness events fetched by one epoll_wait() call */
+static const int MAX_SOCKET_EVENTS = 1024;
+/** Maximum number of queued send buffers written by one sendmsg() call */
+static const size_t MAX_SEND_BATCH_BUFFERS = 128;
+/** Byte budget of one sendmsg() call; the buffer that crosses it is still included */
+static const size_t MAX_SEND_BATCH_SIZE = 256 * 1024;
+/** Minimum seconds one addrman sample is reused to answer getaddr requests, up to half as long again at random */
+static const int64_t GETADDR_RESPONSE_CACHE_TIME = 10 * 60;
+/** -msgdecodethreads default: workers deserializing message payloads ahead of the message handler */
+static const int DEFAULT_MESSAGE_DECODE_THREADS = 2;
+/** Maximum number of message decode threads */
+static const int MAX_MESSAGE_DECODE_THREADS = 16;
+/** Seconds between checks for expired Dandelion embargoes */
+static const int64_t DANDELION_EMBARGO_CHECK_INTERVAL = 1;
+
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
 unsigned int ReceiveFloodSize();
@@ -132,6 +173,8 @@ struct AddedNodeInfo
 class CTransaction;
 class CNodeStats;
 class CClientUIInterface;
+class CNetMessage;
+class CDecodedPayload;
 
 struct CSerializedNetMsg
 {
@@ -146,6 +189,68 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/**
+ * Per message type counters and histograms of the message handler: payload sizes,
+ * decode time on the decode pool, time queued before processing and ProcessMessage
+ * time. Commands we do not know are counted together, so the map never grows.
+ */
+class CNetMsgStats
+{
+public:
+    //! Bucket i counts values below 2^i (bytes or microseconds), the last one everything larger
+    static const int HISTOGRAM_BUCKETS = 24;
+
+    struct Histogram
+    {
+        uint64_t nCount = 0;
+        int64_t nSum = 0;
+        int64_t nMax = 0;
+        std::vector<uint64_t> vBuckets = std::vector<uint64_t>(HISTOGRAM_BUCKETS, 0);
+
+        void Add(int64_t nValue);
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(nCount);
+            READWRITE(nSum);
+            READWRITE(nMax);
+            READWRITE(vBuckets);
+        }
+    };
+
+    struct Entry
+    {
+        Histogram size;
+        Histogram decode;
+        Histogram queue;
+        Histogram process;
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(size);
+            READWRITE(decode);
+            READWRITE(queue);
+            READWRITE(process);
+        }
+    };
+
+    CNetMsgStats();
+
+    void RecordDecode(const std::string& strCommand, int64_t nMicros);
+    void RecordProcess(const std::string& strCommand, size_t nSize, int64_t nQueueMicros, int64_t nProcessMicros);
+    std::map<std::string, Entry> GetStats() const;
+
+private:
+    Entry& GetEntry(const std::string& strCommand);
+
+    mutable CCriticalSection cs_stats;
+    std::map<std::string, Entry> mapStats;
+};
+
 
 class CConnman
 {
@@ -172,6 +277,8 @@ public:
         unsigned int nReceiveFloodSize = 0;
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
+        SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
+        int nMessageDecodeThreads = 0;
     };
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
@@ -330,7 +437,8 @@ public:
     void MarkAddressGood(const CAddress& addr);
     void AddNewAddress(const CAddress& addr, const CAddress& addrFrom, int64_t nTimePenalty = 0);
     void AddNewAddresses(const std::vector<CAddress>& vAddr, const CAddress& addrFrom, int64_t nTimePenalty = 0);
-    std::vector<CAddress> GetAddresses();
+    /** Addresses to answer a getaddr from pnode with, cached per network and local address */
+    std::vector<CAddress> GetAddresses(const CNode* pnode);
     void AddressCurrentlyConnected(const CService& addr);
 
     // Denial-of-service detection/prevention
@@ -415,6 +523,8 @@ public:
 
     unsigned int GetReceiveFloodSize() const;
 
+    CNetMsgStats& GetMsgStats() { return msgStats; }
+
     void WakeMessageHandler();
 private:
     struct ListenSocket {
@@ -451,6 +561,19 @@ private:
     NodeId GetNewNodeId();
 
     size_t SocketSendData(CNode *pnode) const;
+
+    //! Hand a completed message to the decode workers if its command has a pre-parser
+    void StartDecodingMessage(CNode *pnode, CNetMessage &msg);
+
+    //! Start watching a newly connected node's socket (epoll mode only). On failure
+    //! the node is marked for disconnection, as its socket would never be serviced
+    bool RegisterEvents(CNode *pnode);
+    //! Wait up to nTimeoutMs for socket readiness, filling the sets with the ready sockets
+    void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, int nTimeoutMs);
+    void SocketEventsSelect(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, int nTimeoutMs);
+#ifdef USE_EPOLL
+    void SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, int nTimeoutMs);
+#endif
     //!check is the banlist has unwritten changes
     bool BannedSetIsDirty();
     //!set the "dirty" flag for the banlist
@@ -489,6 +612,11 @@ private:
     unsigned int nReceiveFloodSize;
 
     std::vector<ListenSocket> vhListenSocket;
+    SocketEventsMode socketEventsMode;
+    //! Edge-triggered epoll instance all sockets are registered with, in epoll mode
+    int epollfd;
+    //! Workers deserializing message payloads ahead of ThreadMessageHandler, null if disabled
+    std::unique_ptr<ctpl::thread_pool> messageDecodePool;
     std::atomic<bool> fNetworkActive;
     banmap_t setBanned;
     CCriticalSection cs_setBanned;
@@ -531,6 +659,21 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
+    CNetMsgStats msgStats;
+
+    /** Addresses sent in reply to getaddr until nExpire */
+    struct CachedAddrResponse {
+        std::vector<CAddress> vAddr;
+        int64_t nExpire;
+    };
+    /**
+     * One response per network and local address peers connect to, so a node
+     * reachable on several networks can't be linked by comparing the responses.
+     * Bounded by the number of local addresses we accept connections on.
+     */
+    std::map<uint64_t, CachedAddrResponse> mapAddrResponseCache;
+    CCriticalSection cs_mapAddrResponseCache;
+
     /** flag for waking the message processor. */
     bool fMsgProcWake;
 
@@ -576,6 +719,7 @@ struct CNodeSignals
     boost::signals2::signal<bool (CNode*, CConnman&, std::atomic<bool>&), CombinerAll> SendMessages;
     boost::signals2::signal<void (CNode*, CConnman&)> InitializeNode;
     boost::signals2::signal<void (NodeId, bool&)> FinalizeNode;
+    boost::signals2::signal<void (const std::string&, CDataStream&, CDecodedPayload&)> DecodeMessage;
 };
 
 
@@ -660,6 +804,40 @@ public:
 
 
 
+/**
+ * Payload of a CNetMessage that was deserialized by a message decode worker
+ * before the message handler got to it. The payload type is fixed per command
+ * (see DecodeMessage in net_processing.cpp); a failure to deserialize is kept
+ * and rethrown to the handler at the point where it reads the payload.
+ */
+class CDecodedPayload
+{
+private:
+    std::shared_ptr<void> payload;
+    std::exception_ptr error;
+
+public:
+    template<typename T>
+    void Set(std::shared_ptr<T> payloadIn)
+    {
+        payload = std::const_pointer_cast<typename std::remove_const<T>::type>(payloadIn);
+    }
+
+    void SetError(std::exception_ptr errorIn)
+    {
+        error = errorIn;
+    }
+
+    //! The decoded payload, or nullptr if the message has to be read from vRecv
+    template<typename T>
+    std::shared_ptr<T> Get() const
+    {
+        if (error)
+            std::rethrow_exception(error);
+        return std::static_pointer_cast<T>(payload);
+    }
+};
+
 class CNetMessage {
 private:
     mutable CHash256 hasher;
@@ -676,6 +854,9 @@ public:
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
+    CDecodedPayload decoded;        // payload deserialized by a decode worker, if any
+    std::shared_future<void> decoding; // ready once the decode worker is done with this message
+
     CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         hdrbuf.resize(24);
         in_data = false;
@@ -684,6 +865,19 @@ public:
         nTime = 0;
     }
 
+    CNetMessage(CNetMessage&&) = default;
+
+    ~CNetMessage() {
+        WaitDecoded();
+    }
+
+    //! Wait for the decode worker, if any; vRecv and decoded must not be touched before
+    void WaitDecoded() const
+    {
+        if (decoding.valid())
+            decoding.wait();
+    }
+
     bool complete() const
     {
         if (!in_data)
@@ -720,6 +914,10 @@ public:
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
+    // Readiness last reported by edge-triggered epoll, protected by cs_hSocket.
+    // Cleared once recv()/send() show the socket has been drained or filled.
+    bool fHasRecvData;
+    bool fCanSendData;
 
     CCriticalSection cs_vProcessMsg;
     std::list<CNetMessage> vProcessMsg;
@@ -728,6 +926,8 @@ public:
     CCriticalSection cs_sendProcessing;
 
     std::deque<CInv> vRecvGetData;
+    //! Orphans whose missing parents have all been accepted, awaiting re-validation (message handler thread only)
+    std::set<uint256> setOrphanWork;
     uint64_t nRecvBytes;
     std::atomic<int> nRecvVersion;
 
@@ -739,6 +939,8 @@ public:
     std::atomic<int64_t> nTimeFirstMessageReceived;
     std::atomic<bool> fFirstMessageIsMNAUTH;
     const CAddress addr;
+    // Local address an inbound connection was accepted on
+    const CAddress addrBind;
     std::atomic<int> nNumWarningsSkipped;
     std::atomic<int> nVersion;
     // strSubVer is whatever byte array we read from the wire. However, this field is intended
@@ -855,7 +1057,7 @@ public:
     // If true, we will send him all quorum related messages, even if he is not a member of our quorums
     std::atomic<bool> qwatch{false};
 
-    CNode(NodeId id, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn, SOCKET hSocketIn, const CAddress &addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const std::string &addrNameIn = "", bool fInboundIn = false);
+    CNode(NodeId id, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn, SOCKET hSocketIn, const CAddress &addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const std::string &addrNameIn = "", bool fInboundIn = false, const CAddress &addrBindIn = CAddress());
     ~CNode();
 
 private:
@@ -1011,8 +1213,13 @@ public:
     // in case of no limit, it will always response 0
     static uint64_t GetMaxOutboundTimeLeftInCycle();
 
-    // Public Dandelion field.
-    static std::map<uint256, int64_t> mDandelionEmbargo;
+    // Dandelion embargoes: expiry time (in microseconds) by transaction hash, and the
+    // same entries in a min-heap ordered by expiry. Lifting an embargo only removes it
+    // from the map, its heap entry is skipped once it comes due.
+    typedef std::pair<int64_t, uint256> DandelionEmbargo;
+    static CCriticalSection cs_dandelionEmbargo;
+    static std::unordered_map<uint256, int64_t, StaticSaltedHasher> mDandelionEmbargo;
+    static std::priority_queue<DandelionEmbargo, std::vector<DandelionEmbargo>, std::greater<DandelionEmbargo>> queueDandelionEmbargo;
 
     // Dandelion methods, they all must be static, as they do not belong to any CNode, they belong
 		// to the currently running node.
@@ -25,6 +25,7 @@
 #include "tinyformat.h"
 #include "txmempool.h"
 #include "ui_interface.h"
+#include "unordered_lru_cache.h"
 #include "util.h"
 #include "utilmoneystr.h"
 #include "utilstrencodings.h"
@@ -369,7 +370,7 @@ bool MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const Consensus::Pa
     MarkBlockAsReceived(hash);
 
     std::list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(),
-            {hash, pindex, pindex != NULL, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&mempool) : NULL)});
+            {hash, pindex, pindex != NULL, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&mempool, &txpools.getStemTxPool()) : NULL)});
     state->nBlocksInFlight++;
     state->nBlocksInFlightValidHeaders += it->fValidatedHeaders;
     if (state->nBlocksInFlight == 1) {
@@ -599,6 +600,7 @@ void RegisterNodeSignals(CNodeSignals& nodeSignals)
     nodeSignals.SendMessages.connect(&SendMessages);
     nodeSignals.InitializeNode.connect(&InitializeNode);
     nodeSignals.FinalizeNode.connect(&FinalizeNode);
+    nodeSignals.DecodeMessage.connect(&DecodeMessage);
 }
 
 void UnregisterNodeSignals(CNodeSignals& nodeSignals)
@@ -607,6 +609,7 @@ void UnregisterNodeSignals(CNodeSignals& nodeSignals)
     nodeSignals.SendMessages.disconnect(&SendMessages);
     nodeSignals.InitializeNode.disconnect(&InitializeNode);
     nodeSignals.FinalizeNode.disconnect(&FinalizeNode);
+    nodeSignals.DecodeMessage.disconnect(&DecodeMessage);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -625,6 +628,19 @@ void AddToCompactExtraTransactions(const CTransactionRef& tx)
     vExtraTxnForCompactIt = (vExtraTxnForCompactIt + 1) % max_extra_txn;
 }
 
+//! Parents of tx whose outputs are in neither the mempool nor the UTXO set
+static std::set<uint256> GetMissingParents(const CTransaction& tx) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::set<uint256> setMissing;
+    BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+        if (txin.prevout.IsNull() || setMissing.count(txin.prevout.hash))
+            continue;
+        if (!mempool.exists(txin.prevout.hash) && !pcoinsTip->HaveCoin(txin.prevout))
+            setMissing.insert(txin.prevout.hash);
+    }
+    return setMissing;
+}
+
 bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     const uint256& hash = tx->GetHash();
@@ -692,6 +708,25 @@ void EraseOrphansFor(NodeId peer)
     if (nErased > 0) LogPrint("mempool", "Erased %d orphan tx from peer=%d\n", nErased, peer);
 }
 
+/**
+ * Queue the orphans spending outputs of tx in setOrphanWork once none of their
+ * parents is missing any more. Parents are looked up again rather than tracked,
+ * as they also reach the mempool or the chain through blocks, Dandelion and the wallet.
+ */
+void AddChildrenToWorkSet(const CTransaction& tx, std::set<uint256>& setOrphanWork) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const uint256& hash = tx.GetHash();
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        auto itByPrev = mapOrphanTransactionsByPrev.find(COutPoint(hash, i));
+        if (itByPrev == mapOrphanTransactionsByPrev.end())
+            continue;
+        for (auto mi = itByPrev->second.begin(); mi != itByPrev->second.end(); ++mi) {
+            if (GetMissingParents(*(*mi)->second.tx).empty())
+                setOrphanWork.insert((*mi)->first);
+        }
+    }
+}
+
 
 unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
@@ -810,6 +845,33 @@ static std::shared_ptr<const CBlock> most_recent_block;
 static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block;
 static uint256 most_recent_block_hash;
 
+/** Recently served blocks as stored on disk, so repeated requests skip the block file read */
+static CCriticalSection cs_recent_block_bytes;
+static unordered_lru_cache<uint256, std::shared_ptr<const std::vector<unsigned char>>, BlockHasher> recentBlockBytes(MAX_RECENT_BLOCK_BYTES);
+
+/**
+ * The serialized block to answer a full block request with, or nullptr if the block must be
+ * deserialized first: MTP blocks may need their MTP data stripped for the peer, and a block
+ * stored with witness data serializes differently for a peer that did not ask for witnesses.
+ */
+static std::shared_ptr<const std::vector<unsigned char>> GetRawBlockToServe(const CBlockIndex* pindex, bool fWitness)
+{
+    CBlockHeader header = pindex->GetBlockHeader();
+    if ((header.IsMTP() && !header.IsProgPow()) || (!fWitness && (pindex->nStatus & BLOCK_OPT_WITNESS)))
+        return nullptr;
+
+    std::shared_ptr<const std::vector<unsigned char>> pblockBytes;
+    LOCK(cs_recent_block_bytes);
+    if (recentBlockBytes.get(pindex->GetBlockHash(), pblockBytes))
+        return pblockBytes;
+
+    std::shared_ptr<std::vector<unsigned char>> pread = std::make_shared<std::vector<unsigned char>>();
+    if (!ReadRawBlockFromDisk(*pread, pindex, Params().MessageStart()))
+        return nullptr;
+    recentBlockBytes.insert(pindex->GetBlockHash(), pread);
+    return pread;
+}
+
 void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) {
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs> (*pblock, true);
     const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
@@ -1087,25 +1149,40 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
                 {
+                    // Full blocks are sent as the bytes stored on disk when possible
+                    std::shared_ptr<const std::vector<unsigned char>> pblockBytes;
+                    if (inv.type == MSG_BLOCK || inv.type == MSG_WITNESS_BLOCK)
+                        pblockBytes = GetRawBlockToServe(mi->second, inv.type == MSG_WITNESS_BLOCK);
+                    else if (inv.type == MSG_CMPCT_BLOCK && !(CanDirectFetch(consensusParams) && mi->second->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH))
+                        pblockBytes = GetRawBlockToServe(mi->second, State(pfrom->GetId())->fWantsCmpctWitness);
+
                     // Send block from disk
                     CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second, consensusParams))
-                        assert(!"cannot load block from disk");
-                    // Strip MTP data if past specific point of time
-                    if (!block.IsProgPow() && block.IsMTP() && GetTime() >= consensusParams.nMTPStripDataTime) {
-                        if (pfrom->nVersion >= MTPDATA_STRIPPED_VERSION) {
-                            if (block.mtpHashData)
-                                block.mtpHashData->StripMTPData();
-                        }
-                        else {
-                            // node is not ready for a block with stripped MTP data. Skip the block if MTP
-                            // data has already been stripped locally
-                            if (!block.mtpHashData || block.mtpHashData->IsMTPDataStripped())
-                                continue;
+                    if (!pblockBytes) {
+                        if (!ReadBlockFromDisk(block, (*mi).second, consensusParams))
+                            assert(!"cannot load block from disk");
+                        // Strip MTP data if past specific point of time
+                        if (!block.IsProgPow() && block.IsMTP() && GetTime() >= consensusParams.nMTPStripDataTime) {
+                            if (pfrom->nVersion >= MTPDATA_STRIPPED_VERSION) {
+                                if (block.mtpHashData)
+                                    block.mtpHashData->StripMTPData();
+                            }
+                            else {
+                                // node is not ready for a block with stripped MTP data. Skip the block if MTP
+                                // data has already been stripped locally
+                                if (!block.mtpHashData || block.mtpHashData->IsMTPDataStripped())
+                                    continue;
+                            }
                         }
                     }
 
-                    if (inv.type == MSG_BLOCK)
+                    if (pblockBytes) {
+                        CSerializedNetMsg msg;
+                        msg.command = NetMsgType::BLOCK;
+                        msg.data.assign(pblockBytes->begin(), pblockBytes->end());
+                        connman.PushMessage(pfrom, std::move(msg));
+                    }
+                    else if (inv.type == MSG_BLOCK)
                         connman.PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block));
                     else if (inv.type == MSG_WITNESS_BLOCK)
                         connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
@@ -1333,7 +1410,87 @@ inline void static SendBlockTransactions(const CBlock& block, const BlockTransac
     connman.PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCKTXN, resp));
 }
 
-bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
+/**
+ * Re-validate orphans from setOrphanWork until one of them is accepted or
+ * rejected, so a chain of dependent transactions is resolved one transaction
+ * per ProcessMessages call instead of all at once inside a single TX message.
+ */
+void static ProcessOrphanWork(CConnman& connman, std::set<uint256>& setOrphanWork, std::list<CTransactionRef>& lRemovedTxn) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::set<NodeId> setMisbehaving;
+    bool fDone = false;
+    while (!fDone && !setOrphanWork.empty()) {
+        const uint256 orphanHash = *setOrphanWork.begin();
+        setOrphanWork.erase(setOrphanWork.begin());
+
+        auto itOrphan = mapOrphanTransactions.find(orphanHash);
+        if (itOrphan == mapOrphanTransactions.end())
+            continue;
+
+        const CTransactionRef porphanTx = itOrphan->second.tx;
+        const CTransaction& orphanTx = *porphanTx;
+        NodeId fromPeer = itOrphan->second.fromPeer;
+        bool fMissingInputs2 = false;
+        // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
+        // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
+        // anyone relaying LegitTxX banned)
+        CValidationState stateDummy;
+        CValidationState stateDummyDandelion;
+
+        if (setMisbehaving.count(fromPeer))
+            continue;
+        if (AcceptToMemoryPool(mempool, stateDummy, porphanTx, true, &fMissingInputs2, &lRemovedTxn, false, 0, true)) {
+            LogPrint("mempool", "   accepted orphan tx %s\n", orphanHash.ToString());
+
+            // Changes to mempool should also be made to Dandelion stempool
+            AcceptToMemoryPool(
+                txpools.getStemTxPool(),
+                stateDummyDandelion,
+                porphanTx,
+                true, /* fLimitFree */
+                &fMissingInputs2,  /* pfMissingInputs */
+                nullptr,
+                false, /* fOverrideMempoolLimit */
+                0, /* nAbsurdFee */
+                true, /* isCheckWalletTransaction */
+                false /* markFiroSpendTransactionSerial */
+            );
+
+            connman.RelayTransaction(orphanTx);
+            AddChildrenToWorkSet(orphanTx, setOrphanWork);
+            EraseOrphanTx(orphanHash);
+            fDone = true;
+        }
+        else if (!fMissingInputs2)
+        {
+            int nDos = 0;
+            if (stateDummy.IsInvalid(nDos) && nDos > 0)
+            {
+                // Punish peer that gave us an invalid orphan tx
+                Misbehaving(fromPeer, nDos);
+                setMisbehaving.insert(fromPeer);
+                LogPrint("mempool", "   invalid orphan tx %s\n", orphanHash.ToString());
+            }
+            // Has inputs but not accepted to mempool
+            // Probably non-standard or insufficient fee/priority
+            LogPrint("mempool", "   removed orphan tx %s\n", orphanHash.ToString());
+            if (!orphanTx.HasWitness() && !stateDummy.CorruptionPossible()) {
+                // Do not use rejection cache for witness transactions or
+                // witness-stripped transactions, as they can have been malleated.
+                // See https://github.com/bitcoin/bitcoin/issues/8279 for details.
+                assert(recentRejects);
+                recentRejects->insert(orphanHash);
+            }
+            EraseOrphanTx(orphanHash);
+            // the peer's misbehaviour doesn't use up this turn
+            fDone = !setMisbehaving.count(fromPeer);
+        }
+        // still missing inputs: stays an orphan until another parent arrives
+        mempool.check(pcoinsTip);
+    }
+}
+
+bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, const CDecodedPayload& decoded, int64_t nTimeReceived, const CChainParams& chainparams, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
     LogPrint("net", "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
     if (IsArgSet("-dropmessagestest") && GetRand(GetArg("-dropmessagestest", 0)) == 0)
@@ -1357,11 +1514,6 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         }
     }
 
-    {
-        LOCK(cs_main);
-        CNode::CheckDandelionEmbargoes();
-    }
-
     if (strCommand == NetMsgType::REJECT)
     {
         if (fDebug) {
@@ -2020,14 +2172,14 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
-        std::deque<COutPoint> vWorkQueue;
-        std::vector<uint256> vEraseQueue;
 
         int nInvType = MSG_TX;
         CTransactionRef ptx;
 
         // Read data and assign inv type
-        vRecv >> ptx;
+        ptx = decoded.Get<const CTransaction>();
+        if (!ptx)
+            vRecv >> ptx;
 
         const CTransaction& tx = *ptx;
 
@@ -2069,9 +2221,8 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
             mempool.check(pcoinsTip);
             connman.RelayTransaction(tx);
-            for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                vWorkQueue.emplace_back(inv.hash, i);
-            }
+            // Orphans waiting on nothing else are re-validated from ProcessMessages
+            AddChildrenToWorkSet(tx, pfrom->setOrphanWork);
 
             pfrom->nLastTXTime = GetTime();
 
@@ -2079,83 +2230,6 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 pfrom->id,
                 tx.GetHash().ToString(),
                 mempool.size(), mempool.DynamicMemoryUsage() / 1000);
-
-            // Recursively process any orphan transactions that depended on this one
-            std::set<NodeId> setMisbehaving;
-            while (!vWorkQueue.empty()) {
-                auto itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue.front());
-                vWorkQueue.pop_front();
-                if (itByPrev == mapOrphanTransactionsByPrev.end())
-                    continue;
-                for (auto mi = itByPrev->second.begin();
-                     mi != itByPrev->second.end();
-                     ++mi)
-                {
-                    const CTransactionRef& porphanTx = (*mi)->second.tx;
-                    const CTransaction& orphanTx = *porphanTx;
-                    const uint256& orphanHash = orphanTx.GetHash();
-                    NodeId fromPeer = (*mi)->second.fromPeer;
-                    bool fMissingInputs2 = false;
-                    // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
-                    // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
-                    // anyone relaying LegitTxX banned)
-                    CValidationState stateDummy;
-                    CValidationState stateDummyDandelion;
-
-
-                    if (setMisbehaving.count(fromPeer))
-                        continue;
-                    if (AcceptToMemoryPool(mempool, stateDummy, porphanTx, true, &fMissingInputs2, &lRemovedTxn, false, 0, true)) {
-                        LogPrint("mempool", "   accepted orphan tx %s\n", orphanHash.ToString());
-
-                        // Changes to mempool should also be made to Dandelion stempool
-                        AcceptToMemoryPool(
-                            txpools.getStemTxPool(),
-                            stateDummyDandelion,
-                            porphanTx,
-                            true, /* fLimitFree */
-                            &fMissingInputs2,  /* pfMissingInputs */
-                            nullptr,
-                            false, /* fOverrideMempoolLimit */
-                            0, /* nAbsurdFee */
-                            true, /* isCheckWalletTransaction */
-                            false /* markFiroSpendTransactionSerial */
-                        );
-
-                        connman.RelayTransaction(orphanTx);
-                        for (unsigned int i = 0; i < orphanTx.vout.size(); i++) {
-                            vWorkQueue.emplace_back(orphanHash, i);
-                        }
-                        vEraseQueue.push_back(orphanHash);
-                    }
-                    else if (!fMissingInputs2)
-                    {
-                        int nDos = 0;
-                        if (stateDummy.IsInvalid(nDos) && nDos > 0)
-                        {
-                            // Punish peer that gave us an invalid orphan tx
-                            Misbehaving(fromPeer, nDos);
-                            setMisbehaving.insert(fromPeer);
-                            LogPrint("mempool", "   invalid orphan tx %s\n", orphanHash.ToString());
-                        }
-                        // Has inputs but not accepted to mempool
-                        // Probably non-standard or insufficient fee/priority
-                        LogPrint("mempool", "   removed orphan tx %s\n", orphanHash.ToString());
-                        vEraseQueue.push_back(orphanHash);
-                        if (!orphanTx.HasWitness() && !stateDummy.CorruptionPossible()) {
-                            // Do not use rejection cache for witness transactions or
-                            // witness-stripped transactions, as they can have been malleated.
-                            // See https://github.com/bitcoin/bitcoin/issues/8279 for details.
-                            assert(recentRejects);
-                            recentRejects->insert(orphanHash);
-                        }
-                    }
-                    mempool.check(pcoinsTip);
-                }
-            }
-
-            BOOST_FOREACH(uint256 hash, vEraseQueue)
-                EraseOrphanTx(hash);
         }
         else if (fMissingInputs)
         {
@@ -2241,8 +2315,9 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     else if (strCommand == NetMsgType::DANDELIONTX)
     {
         CValidationState state;
-        CTransactionRef ptx;
-        vRecv >> ptx;
+        CTransactionRef ptx = decoded.Get<const CTransaction>();
+        if (!ptx)
+            vRecv >> ptx;
         const CTransaction &tx = *ptx;
 
         bool fMissingInputs = false;
@@ -2396,7 +2471,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 std::list<QueuedBlock>::iterator* queuedBlockIt = NULL;
                 if (!MarkBlockAsInFlight(pfrom->GetId(), pindex->GetBlockHash(), chainparams.GetConsensus(), pindex, &queuedBlockIt)) {
                     if (!(*queuedBlockIt)->partialBlock)
-                        (*queuedBlockIt)->partialBlock.reset(new PartiallyDownloadedBlock(&mempool));
+                        (*queuedBlockIt)->partialBlock.reset(new PartiallyDownloadedBlock(&mempool, &txpools.getStemTxPool()));
                     else {
                         // The block was already in flight using compact blocks from the same peer
                         LogPrint("net", "Peer sent us compact block we were already syncing!\n");
@@ -2440,7 +2515,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 // download from.
                 // Optimistically try to reconstruct anyway since we might be
                 // able to without any round trips.
-                PartiallyDownloadedBlock tempBlock(&mempool);
+                PartiallyDownloadedBlock tempBlock(&mempool, &txpools.getStemTxPool());
                 ReadStatus status = tempBlock.InitData(cmpctblock, vExtraTxnForCompact);
                 if (status != READ_STATUS_OK) {
                     // TODO: don't ignore failures
@@ -2472,10 +2547,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         } // cs_main
 
         if (fProcessBLOCKTXN)
-            return ProcessMessage(pfrom, NetMsgType::BLOCKTXN, blockTxnMsg, nTimeReceived, chainparams, connman, interruptMsgProc);
+            return ProcessMessage(pfrom, NetMsgType::BLOCKTXN, blockTxnMsg, CDecodedPayload(), nTimeReceived, chainparams, connman, interruptMsgProc);
 
         if (fRevertToHeaderProcessing)
-            return ProcessMessage(pfrom, NetMsgType::HEADERS, vHeadersMsg, nTimeReceived, chainparams, connman, interruptMsgProc);
+            return ProcessMessage(pfrom, NetMsgType::HEADERS, vHeadersMsg, CDecodedPayload(), nTimeReceived, chainparams, connman, interruptMsgProc);
 
         if (fBlockReconstructed) {
             // If we got here, we were able to optimistically reconstruct a
@@ -2721,8 +2796,11 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
     else if (strCommand == NetMsgType::BLOCK && !fImporting && !fReindex) // Ignore blocks received while importing
     {
-        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-        vRecv >> *pblock;
+        std::shared_ptr<CBlock> pblock = decoded.Get<CBlock>();
+        if (!pblock) {
+            pblock = std::make_shared<CBlock>();
+            vRecv >> *pblock;
+        }
 
         if (pblock->IsMTP() && !pblock->IsProgPow() && pblock->mtpHashData && GetTime() >= chainparams.GetConsensus().nMTPStripDataTime)
         {
@@ -2775,7 +2853,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         pfrom->fSentAddr = true;
 
         pfrom->vAddrToSend.clear();
-        std::vector<CAddress> vAddr = connman.GetAddresses();
+        std::vector<CAddress> vAddr = connman.GetAddresses(pfrom);
         FastRandomContext insecure_rand;
         BOOST_FOREACH(const CAddress &addr, vAddr)
             pfrom->PushAddress(addr, insecure_rand);
@@ -3003,7 +3081,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             llmq::quorumSigSharesManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
             llmq::quorumSigningManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
             llmq::chainLocksHandler->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumInstantSendManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
+            llmq::quorumInstantSendManager->ProcessMessage(pfrom, strCommand, vRecv, decoded, connman);
         } else {
             // Ignore unknown commands for extensibility
             LogPrint("net", "Unknown command \"%s\" from peer=%d\n", SanitizeString(strCommand), pfrom->id);
@@ -3045,6 +3123,30 @@ static bool SendRejectsAndCheckIfBanned(CNode* pnode, CConnman& connman)
     return false;
 }
 
+void DecodeMessage(const std::string& strCommand, CDataStream& vRecv, CDecodedPayload& decoded)
+{
+    // Only stateless deserialization belongs here, it runs concurrently with ProcessMessage
+    try {
+        if (strCommand == NetMsgType::TX || strCommand == NetMsgType::DANDELIONTX) {
+            CTransactionRef ptx;
+            vRecv >> ptx;
+            decoded.Set(ptx);
+        } else if (strCommand == NetMsgType::BLOCK) {
+            auto pblock = std::make_shared<CBlock>();
+            vRecv >> *pblock;
+            decoded.Set(pblock);
+        } else if (strCommand == NetMsgType::ISLOCK) {
+            auto islock = std::make_shared<llmq::CInstantSendLock>();
+            vRecv >> *islock;
+            // Lazy BLS signatures decompress on first use, do that here as well
+            islock->sig.Get();
+            decoded.Set(islock);
+        }
+    } catch (...) {
+        decoded.SetError(std::current_exception());
+    }
+}
+
 bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -3064,8 +3166,20 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
     if (pfrom->fDisconnect)
         return false;
 
+    if (!pfrom->setOrphanWork.empty()) {
+        std::list<CTransactionRef> lRemovedTxn;
+        {
+            LOCK(cs_main);
+            ProcessOrphanWork(connman, pfrom->setOrphanWork, lRemovedTxn);
+        }
+        for (const CTransactionRef& removedTx : lRemovedTxn)
+            AddToCompactExtraTransactions(removedTx);
+    }
+
     // this maintains the order of responses
     if (!pfrom->vRecvGetData.empty()) return true;
+    // resolve orphans before taking further messages from this peer
+    if (!pfrom->setOrphanWork.empty()) return true;
 
         // Don't bother if send buffer is too full to respond anyway
         if (pfrom->fPauseSend)
@@ -3083,6 +3197,7 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
             fMoreWork = !pfrom->vProcessMsg.empty();
         }
         CNetMessage& msg(msgs.front());
+        msg.WaitDecoded();
 
         msg.SetVersion(pfrom->GetRecvVersion());
         // Scan for message start
@@ -3118,9 +3233,10 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
 
         // Process message
         bool fRet = false;
+        int64_t nProcessStart = GetTimeMicros();
         try
         {
-            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
+            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.decoded, msg.nTime, chainparams, connman, interruptMsgProc);
             if (interruptMsgProc)
                 return false;
             if (!pfrom->vRecvGetData.empty())
@@ -3152,6 +3268,7 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
         catch (...) {
             PrintExceptionContinue(std::current_exception(), "ProcessMessages()");
         }
+        connman.GetMsgStats().RecordProcess(strCommand, nMessageSize, nProcessStart - msg.nTime, GetTimeMicros() - nProcessStart);
 
         if (!fRet) {
             LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->id);
@@ -17,6 +17,8 @@ static const int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
 static const int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
 /** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
+/** Number of recently served blocks kept serialized in memory for getdata */
+static const unsigned int MAX_RECENT_BLOCK_BYTES = 8;
 
 /** Register with a network node to receive its signals */
 void RegisterNodeSignals(CNodeSignals& nodeSignals);
@@ -50,6 +52,8 @@ void Misbehaving(NodeId nodeid, int howmuch);
 
 bool IsBanned(NodeId nodeid);
 
+/** Deserialize the payload of a message ahead of ProcessMessages, on a message decode worker */
+void DecodeMessage(const std::string& strCommand, CDataStream& vRecv, CDecodedPayload& decoded);
 /** Process protocol messages received from a given node */
 bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interrupt);
 /**
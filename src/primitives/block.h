@@ -49,7 +49,7 @@ class CMTPHashData {
 public:
     uint8_t hashRootMTP[16]; // 16 is 128 bit of blake2b
     uint64_t nBlockMTP[mtp::MTP_L*2][128]; // 128 is ARGON2_QWORDS_IN_BLOCK
-    std::deque<std::vector<uint8_t>> nProofMTP[mtp::MTP_L*3];
+    mtp::ProofArena nProofMTP; // all the Merkle proofs in one buffer
 
     CMTPHashData() {
         memset(hashRootMTP, 0, sizeof(hashRootMTP));
@@ -79,15 +79,12 @@ public:
             return;
 
         READWRITE(nBlockMTP);
-        for (int i = 0; i < mtp::MTP_L*3; i++) {
-            assert(nProofMTP[i].size() < 256);
-            uint8_t numberOfProofBlocks = (uint8_t)nProofMTP[i].size();
+        for (size_t i = 0; i < mtp::ProofArena::PROOFS; i++) {
+            // proofs that were never filled in are written empty
+            uint8_t numberOfProofBlocks = i < nProofMTP.size() ? (uint8_t)nProofMTP.size(i) : 0;
             READWRITE(numberOfProofBlocks);
-            for (const std::vector<uint8_t> &mtpData: nProofMTP[i]) {
-                // data size should be 16 for each block
-                assert(mtpData.size() == 16);
-                s.write((const char *)mtpData.data(), 16);
-            }
+            if (numberOfProofBlocks > 0)
+                s.write((const char *)nProofMTP.data(i), numberOfProofBlocks * mtp::MTP_PROOF_HASH_SIZE);
         }
     }
 
@@ -100,14 +97,14 @@ public:
             return;
 
         READWRITE(nBlockMTP);
-        for (int i = 0; i < mtp::MTP_L*3; i++) {
+        // the proofs are read straight into a single arena
+        nProofMTP.clear();
+        nProofMTP.reserve();
+        for (size_t i = 0; i < mtp::ProofArena::PROOFS; i++) {
             uint8_t numberOfProofBlocks;
             READWRITE(numberOfProofBlocks);
-            for (uint8_t j=0; j<numberOfProofBlocks; j++) {
-                std::vector<uint8_t> mtpData(16, 0);
-                s.read((char *)mtpData.data(), 16);
-                nProofMTP[i].emplace_back(std::move(mtpData));
-            }
+            uint8_t *mtpData = nProofMTP.push_back(numberOfProofBlocks);
+            s.read((char *)mtpData, numberOfProofBlocks * mtp::MTP_PROOF_HASH_SIZE);
         }
     }
 };
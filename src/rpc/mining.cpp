@@ -579,7 +579,6 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     if (Params().GetConsensus().IsMain() && !masternodeSync.IsSynced())
         throw JSONRPCError(RPC_CLIENT_IN_INITIAL_DOWNLOAD, "Firo Core is syncing with network...");
 
-    static unsigned int nTransactionsUpdatedLast;
     if (!lpval.isNull())
     {
         // Wait to respond until either the best block changes, OR a minute has passed and there are more transactions
@@ -599,7 +598,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
         {
             // NOTE: Spec does not specify behaviour for non-string longpollid, but this makes testing easier
             hashWatchedChain = chainActive.Tip()->GetBlockHash();
-            nTransactionsUpdatedLastLP = nTransactionsUpdatedLast;
+            nTransactionsUpdatedLastLP = blockTemplateCache.GetTransactionsUpdated();
         }
 
         // Release the wallet and main lock while waiting
@@ -632,36 +631,18 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     // don't).
     bool fSupportsSegwit = setClientRules.find(segwit_info.name) != setClientRules.end();
 
-    // Update block
-    static CBlockIndex* pindexPrev;
-    static int64_t nStart;
-    static std::unique_ptr<CBlockTemplate> pblocktemplate;
-    // Cache whether the last invocation was with segwit support, to avoid returning
-    // a segwit-block to a non-segwit caller.
-    static bool fLastTemplateSupportsSegwit = true;
-    if (pindexPrev != chainActive.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5) ||
-        fLastTemplateSupportsSegwit != fSupportsSegwit)
-    {
-        // Clear pindexPrev so future calls make a new block, despite any failures from here on
-        pindexPrev = nullptr;
+    // Update block. Longpoll clients woken by the same change share the cached template
+    bool fNewTemplate;
+    CScript scriptDummy = CScript() << OP_TRUE;
+    const CBlockTemplate* pcachedTemplate = blockTemplateCache.Get(Params(), scriptDummy, fSupportsSegwit, fNewTemplate);
+    if (!pcachedTemplate)
+        throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
+    if (fNewTemplate)
         mapPPBlockTemplates.clear();
 
-        // Store the pindexBest used before CreateNewBlock, to avoid races
-        nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-        CBlockIndex* pindexPrevNew = chainActive.Tip();
-        nStart = GetTime();
-        fLastTemplateSupportsSegwit = fSupportsSegwit;
-
-        // Create new block
-        CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate = BlockAssembler(Params()).CreateNewBlock(scriptDummy, fSupportsSegwit);
-        if (!pblocktemplate)
-            throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
-
-        // Need to update only after we know CreateNewBlock succeeded
-        pindexPrev = pindexPrevNew;
-    }
+    // Work on a copy, the reward address below must not leak into the cached template
+    std::unique_ptr<CBlockTemplate> pblocktemplate(new CBlockTemplate(*pcachedTemplate));
+    CBlockIndex* pindexPrev = blockTemplateCache.GetPrev();
     CBlock* pblock = &pblocktemplate->block; // pointer for convenience
     const Consensus::Params& consensusParams = Params().GetConsensus();
 
@@ -805,7 +786,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     result.push_back(Pair("transactions", transactions));
     result.push_back(Pair("coinbaseaux", aux));
     result.push_back(Pair("coinbasevalue", (int64_t)pblock->vtx[0]->vout[0].nValue));
-    result.push_back(Pair("longpollid", chainActive.Tip()->GetBlockHash().GetHex() + i64tostr(nTransactionsUpdatedLast)));
+    result.push_back(Pair("longpollid", chainActive.Tip()->GetBlockHash().GetHex() + i64tostr(blockTemplateCache.GetTransactionsUpdated())));
     result.push_back(Pair("target", hashTarget.GetHex()));
     result.push_back(Pair("mintime", (int64_t)pindexPrev->GetMedianTimePast()+1));
     result.push_back(Pair("mutable", aMutable));
@@ -4,6 +4,7 @@
 
 #include "rpc/server.h"
 
+#include "blockencodings.h"
 #include "chainparams.h"
 #include "clientversion.h"
 #include "validation.h"
@@ -374,6 +375,100 @@ UniValue getnettotals(const JSONRPCRequest& request)
     return obj;
 }
 
+static UniValue NetMsgHistogramToJSON(const CNetMsgStats::Histogram& histogram)
+{
+    UniValue buckets(UniValue::VARR);
+    for (uint64_t nBucket : histogram.vBuckets)
+        buckets.push_back(nBucket);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("count", histogram.nCount));
+    obj.push_back(Pair("sum", histogram.nSum));
+    obj.push_back(Pair("max", histogram.nMax));
+    obj.push_back(Pair("buckets", buckets));
+    return obj;
+}
+
+UniValue getnetmsgstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            "getnetmsgstats\n"
+            "\nReturns per message type statistics of the message handler since startup.\n"
+            "Message types that were never processed are left out. Every histogram has\n"
+            "the layout below; bucket i counts values below 2^i, the last bucket all larger ones.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"msgtype\": {          (object) Statistics of the message type\n"
+            "    \"size\": {           (object) Payload sizes in bytes\n"
+            "      \"count\": n,       (numeric) Number of messages\n"
+            "      \"sum\": n,         (numeric) Sum of all values\n"
+            "      \"max\": n,         (numeric) Largest value\n"
+            "      \"buckets\": [n,...] (array) Number of values per bucket\n"
+            "    },\n"
+            "    \"decode\": {...},    (object) Microseconds spent deserializing the payload ahead of the handler\n"
+            "    \"queue\": {...},     (object) Microseconds from receipt until processing started\n"
+            "    \"process\": {...}    (object) Microseconds spent processing the message\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getnetmsgstats", "")
+            + HelpExampleRpc("getnetmsgstats", "")
+       );
+    if(!g_connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    UniValue ret(UniValue::VOBJ);
+    for (const auto& stats : g_connman->GetMsgStats().GetStats()) {
+        const CNetMsgStats::Entry& entry = stats.second;
+        if (entry.size.nCount == 0 && entry.decode.nCount == 0)
+            continue;
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("size", NetMsgHistogramToJSON(entry.size)));
+        obj.push_back(Pair("decode", NetMsgHistogramToJSON(entry.decode)));
+        obj.push_back(Pair("queue", NetMsgHistogramToJSON(entry.queue)));
+        obj.push_back(Pair("process", NetMsgHistogramToJSON(entry.process)));
+        ret.push_back(Pair(stats.first, obj));
+    }
+    return ret;
+}
+
+UniValue getcmpctblockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            "getcmpctblockstats\n"
+            "\nReturns totals over all compact blocks reconstructed since startup, showing where\n"
+            "their transactions were found and how many had to be requested.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"blocks\": n,      (numeric) Blocks reconstructed from compact blocks\n"
+            "  \"roundtrips\": n,  (numeric) Blocks that needed transactions requested with getblocktxn\n"
+            "  \"failed\": n,      (numeric) Reconstructions given up for a full block request\n"
+            "  \"prefilled\": n,   (numeric) Transactions prefilled by the peer\n"
+            "  \"mempool\": n,     (numeric) Transactions found in the mempool\n"
+            "  \"stempool\": n,    (numeric) Transactions found in the Dandelion stem pool\n"
+            "  \"extra\": n,       (numeric) Transactions found among orphan and replaced transactions\n"
+            "  \"requested\": n    (numeric) Transactions requested with getblocktxn\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getcmpctblockstats", "")
+            + HelpExampleRpc("getcmpctblockstats", "")
+       );
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("blocks", compactBlockStats.nBlocks.load()));
+    obj.push_back(Pair("roundtrips", compactBlockStats.nRoundTrips.load()));
+    obj.push_back(Pair("failed", compactBlockStats.nFailed.load()));
+    obj.push_back(Pair("prefilled", compactBlockStats.nPrefilled.load()));
+    obj.push_back(Pair("mempool", compactBlockStats.nFromMempool.load()));
+    obj.push_back(Pair("stempool", compactBlockStats.nFromStempool.load()));
+    obj.push_back(Pair("extra", compactBlockStats.nFromExtra.load()));
+    obj.push_back(Pair("requested", compactBlockStats.nRequested.load()));
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -616,6 +711,8 @@ static const CRPCCommand commands[] =
     { "network",            "disconnectnode",         &disconnectnode,         true,  {"address"} },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true,  {"node"} },
     { "network",            "getnettotals",           &getnettotals,           true,  {} },
+    { "network",            "getnetmsgstats",         &getnetmsgstats,         true,  {} },
+    { "network",            "getcmpctblockstats",     &getcmpctblockstats,     true,  {} },
     { "network",            "getnetworkinfo",         &getnetworkinfo,         true,  {} },
     { "network",            "setban",                 &setban,                 true,  {"subnet", "command", "bantime", "absolute"} },
     { "network",            "listbanned",             &listbanned,             true,  {} },
@@ -192,6 +192,10 @@ bool CheckSigmaSpendTransaction(
 
     Consensus::Params const & params = ::Params().GetConsensus();
 
+    BatchProofContainer* batchProofContainer = BatchProofContainer::get_instance();
+    // proofs already verified in this context on this tip need not be verified again
+    bool fProofVerified = !isVerifyDB && !isCheckWallet && IsPrivacyProofVerified(hashTx, nHeight);
+
     if(!isVerifyDB && !isCheckWallet) {
         if(nRealHeight >= params.nDisableUnpaddedSigmaBlock && nRealHeight < params.nSigmaPaddingBlock)
              return state.DoS(100, error("Sigma is disabled at this period."));
@@ -294,12 +298,11 @@ bool CheckSigmaSpendTransaction(
                 return state.DoS(1, error("Incorrect sigma spend transaction version"));
         }
 
-        BatchProofContainer* batchProofContainer = BatchProofContainer::get_instance();
         // if we are collecting proofs, skip verification and collect proofs
-        passVerify = spend->Verify(anonymity_set, newMetaData, fPadding, batchProofContainer->fCollectProofs);
+        passVerify = spend->Verify(anonymity_set, newMetaData, fPadding, batchProofContainer->fCollectProofs || fProofVerified);
 
         // add proofs into container
-        if(batchProofContainer->fCollectProofs) {
+        if(batchProofContainer->fCollectProofs && !fProofVerified) {
             batchProofContainer->add(spend.get(), fPadding, coinGroupId, anonymity_set.size(), nHeight >= params.nStartSigmaBlacklist);
         }
 
@@ -338,6 +341,8 @@ bool CheckSigmaSpendTransaction(
         if (sigmaTxInfo && !sigmaTxInfo->fInfoIsComplete && hasSigmaSpendInputs) {
             sigmaTxInfo->zcTransactions.insert(hashTx);
         }
+        if (fStatefulSigmaCheck && hasSigmaSpendInputs && !fProofVerified && !batchProofContainer->fCollectProofs)
+            SetPrivacyProofVerified(hashTx, nHeight);
     }
 
     if (hasSigmaSpendInputs) {
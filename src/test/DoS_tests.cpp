@@ -27,6 +27,7 @@
 extern bool AddOrphanTx(const CTransactionRef& tx, NodeId peer);
 extern void EraseOrphansFor(NodeId peer);
 extern unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans);
+extern void AddChildrenToWorkSet(const CTransaction& tx, std::set<uint256>& setOrphanWork);
 struct COrphanTx {
     CTransactionRef tx;
     NodeId fromPeer;
@@ -215,4 +216,51 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     BOOST_CHECK(mapOrphanTransactions.empty());
 }
 
+BOOST_AUTO_TEST_CASE(DoS_orphanWorkSet)
+{
+    LOCK(cs_main);
+
+    // Three unrelated parents none of which we have
+    std::vector<CTransactionRef> parents;
+    for (int i = 0; i < 3; i++)
+    {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.n = 0;
+        tx.vin[0].prevout.hash = GetRandHash();
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 1*CENT;
+        parents.push_back(MakeTransactionRef(tx));
+    }
+
+    // A child spending all of them
+    CMutableTransaction child;
+    child.vin.resize(3);
+    for (int i = 0; i < 3; i++)
+        child.vin[i].prevout = COutPoint(parents[i]->GetHash(), 0);
+    child.vout.resize(1);
+    child.vout[0].nValue = 1*CENT;
+    CTransactionRef childRef = MakeTransactionRef(child);
+
+    BOOST_CHECK(AddOrphanTx(childRef, 0));
+
+    // The child is only retried once every parent has been accepted
+    TestMemPoolEntryHelper entry;
+    std::set<uint256> setOrphanWork;
+    mempool.addUnchecked(parents[0]->GetHash(), entry.FromTx(*parents[0]));
+    AddChildrenToWorkSet(*parents[0], setOrphanWork);
+    BOOST_CHECK(setOrphanWork.empty());
+
+    // A parent reaching the mempool without going through the orphan resolution still counts
+    mempool.addUnchecked(parents[1]->GetHash(), entry.FromTx(*parents[1]));
+    mempool.addUnchecked(parents[2]->GetHash(), entry.FromTx(*parents[2]));
+    AddChildrenToWorkSet(*parents[2], setOrphanWork);
+    BOOST_CHECK_EQUAL(setOrphanWork.size(), 1U);
+    BOOST_CHECK(setOrphanWork.count(childRef->GetHash()));
+
+    mempool.clear();
+    EraseOrphansFor(0);
+    BOOST_CHECK(mapOrphanTransactions.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
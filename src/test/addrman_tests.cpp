@@ -352,6 +352,15 @@ BOOST_AUTO_TEST_CASE(addrman_delete)
     BOOST_CHECK(addrman.size() == 0);
     CAddrInfo* info2 = addrman.Find(addr1);
     BOOST_CHECK(info2 == NULL);
+
+    // The freed slot is reused by the next entry instead of growing the table.
+    CAddress addr2 = CAddress(ResolveService("250.1.2.2", 8333), NODE_NONE);
+    int nId2;
+    CAddrInfo* info3 = addrman.Create(addr2, source1, &nId2);
+    BOOST_CHECK_EQUAL(nId2, nId);
+    BOOST_CHECK(addrman.size() == 1);
+    BOOST_CHECK(addrman.Find(addr2) == info3);
+    BOOST_CHECK(addrman.Find(addr1) == NULL);
 }
 
 BOOST_AUTO_TEST_CASE(addrman_getaddr)
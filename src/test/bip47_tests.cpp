@@ -323,5 +323,43 @@ BOOST_AUTO_TEST_CASE(address_match)
 }
 
 
+BOOST_AUTO_TEST_CASE(address_index)
+{
+    bip47::CWallet walletBob(bob::bip32seed);
+    bip47::CWallet walletAlice(alice::bip32seed);
+
+    bip47::CAccountReceiver & receiver = walletBob.createReceivingAccount("");
+    BOOST_CHECK(walletBob.findReceiver(receiver.getMyNotificationAddress()) == &receiver);
+
+    bip47::CAccountSender & sender = walletAlice.provideSendingAccount(receiver.getMyPcode());
+    receiver.acceptPcode(sender.getMyPcode());
+    walletBob.indexReceiver(receiver);
+
+    size_t const lookahead = bip47::GetAddressLookahead();
+    TheirAddrContT theirAddrs = sender.getPaymentChannel().generateTheirSecretAddresses(0, lookahead + 3);
+    for (size_t i = 0; i < lookahead; ++i)
+        BOOST_CHECK(walletBob.findReceiver(theirAddrs[i]) == &receiver);
+    BOOST_CHECK(walletBob.findReceiver(theirAddrs[lookahead]) == nullptr);
+
+    // the window moves past the used address
+    BOOST_CHECK(walletBob.markAddressUsed(theirAddrs[2]) == &receiver);
+    for (size_t i = 0; i < 3; ++i)
+        BOOST_CHECK(walletBob.findReceiver(theirAddrs[i]) == nullptr);
+    for (size_t i = 3; i < lookahead + 3; ++i)
+        BOOST_CHECK(walletBob.findReceiver(theirAddrs[i]) == &receiver);
+    BOOST_CHECK(walletBob.markAddressUsed(theirAddrs[1]) == nullptr);
+    BOOST_CHECK(walletBob.findReceiver(receiver.getMyNotificationAddress()) == &receiver);
+
+    // a loaded wallet gets the same index
+    bip47::CWallet walletLoaded(bob::bip32seed);
+    CDataStream ds(SER_DISK, 0);
+    ds << receiver;
+    walletLoaded.readReceiver(bip47::CAccountReceiver(deserialize, ds));
+    walletLoaded.precomputeLookahead(2);
+    BOOST_CHECK(walletLoaded.findReceiver(theirAddrs[2]) == nullptr);
+    BOOST_CHECK(walletLoaded.findReceiver(theirAddrs[lookahead + 2]) != nullptr);
+}
+
+
 BOOST_AUTO_TEST_SUITE_END()
         
\ No newline at end of file
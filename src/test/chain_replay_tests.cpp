@@ -0,0 +1,201 @@
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "net.h"
+#include "script/sigcache.h"
+#include "script/standard.h"
+#include "sigma.h"
+#include "lelantus.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include "test/fixtures.h"
+#include "test/testutil.h"
+
+#include "wallet/wallet.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <functional>
+
+/**
+ * Chain replay benchmark: builds a regtest chain with a fixed mix of transparent,
+ * Sigma mint, Lelantus mint and JoinSplit transactions, disconnects it and times
+ * ConnectBlock for each phase of the chain with batch verification off and on.
+ * The timings are reported as test messages (--log_level=message).
+ */
+
+//! Transactions per block of each phase
+struct ReplayMix {
+    size_t blocks;        //!< blocks in every phase
+    size_t transparent;   //!< wallet payments per block, in every phase
+    size_t sigmaMints;    //!< sigma mints per block of the sigma phase
+    size_t lelantusMints; //!< lelantus mints per block of the lelantus phase
+    size_t joinSplits;    //!< joinsplits per block of the joinsplit phase
+};
+
+struct ReplayPhase {
+    std::string name;
+    CBlockIndex *first;
+    CBlockIndex *last;
+    size_t txs;
+};
+
+// Blocks are at least this old when replayed with batching, as during a sync
+static const int64_t REPLAY_BLOCK_AGE = 2 * 24 * 60 * 60;
+
+struct ChainReplaySetup : public LelantusTestingSetup {
+    CScript payee;
+    std::string prevBatching;
+
+    ChainReplaySetup() : prevBatching(GetArg("-batching", "1")) {
+        pwalletMain->SetBroadcastTransactions(true);
+        payee = GetScriptForDestination(GenerateAddress().GetID());
+    }
+
+    // Restored here so a failed BOOST_REQUIRE doesn't leak them into later tests
+    ~ChainReplaySetup() {
+        SetMockTime(0);
+        ForceSetArg("-batching", prevBatching);
+    }
+
+    std::vector<CMutableTransaction> TransparentPayments(size_t count) {
+        std::vector<CMutableTransaction> txs;
+        for (size_t i = 0; i < count; i++) {
+            CWalletTx wtx;
+            CReserveKey reserveKey(pwalletMain);
+            CAmount fee;
+            int changePos = -1;
+            std::string error;
+            BOOST_REQUIRE_MESSAGE(pwalletMain->CreateTransaction({{payee, COIN, false}}, wtx, reserveKey, fee, changePos, error), error);
+            CValidationState state;
+            BOOST_REQUIRE(pwalletMain->CommitTransaction(wtx, reserveKey, g_connman.get(), state));
+            txs.emplace_back(*wtx.tx);
+        }
+        return txs;
+    }
+
+    std::vector<CMutableTransaction> SigmaMints(size_t count) {
+        std::vector<CMutableTransaction> txs;
+        for (size_t i = 0; i < count; i++) {
+            std::vector<sigma::PrivateCoin> privCoins = {sigma::PrivateCoin(sigma::Params::get_default(), sigma::CoinDenomination::SIGMA_DENOM_1)};
+            std::vector<CHDMint> vDMints;
+            auto vecSend = CWallet::CreateSigmaMintRecipients(privCoins, vDMints);
+            CWalletTx wtx;
+            std::string error = pwalletMain->MintAndStoreSigma(vecSend, privCoins, vDMints, wtx);
+            BOOST_REQUIRE_MESSAGE(error.empty(), error);
+            txs.emplace_back(*wtx.tx);
+        }
+        return txs;
+    }
+
+    std::vector<CMutableTransaction> LelantusMints(size_t count) {
+        std::vector<CMutableTransaction> txs;
+        GenerateMints(std::vector<CAmount>(count, COIN), txs);
+        return txs;
+    }
+
+    std::vector<CMutableTransaction> JoinSplits(size_t count) {
+        std::vector<CMutableTransaction> txs;
+        for (size_t i = 0; i < count; i++) {
+            CWalletTx wtx;
+            BOOST_REQUIRE_NO_THROW(pwalletMain->JoinSplitLelantus({{payee, COIN / 2, true}}, {}, wtx));
+            txs.emplace_back(*wtx.tx);
+        }
+        return txs;
+    }
+
+    ReplayPhase BuildPhase(std::string const &name, size_t blocks, size_t transparent,
+            std::function<std::vector<CMutableTransaction>()> privacyTxs) {
+        ReplayPhase phase{name, nullptr, nullptr, 0};
+        for (size_t i = 0; i < blocks; i++) {
+            std::vector<CMutableTransaction> txs = TransparentPayments(transparent);
+            std::vector<CMutableTransaction> privacy = privacyTxs();
+            txs.insert(txs.end(), privacy.begin(), privacy.end());
+
+            CBlockIndex *block = GenerateBlock(txs);
+            BOOST_REQUIRE(block);
+            BOOST_REQUIRE(mempool.size() == 0);
+            if (!phase.first)
+                phase.first = block;
+            phase.last = block;
+            phase.txs += txs.size();
+        }
+        return phase;
+    }
+
+    // Reconnect the disconnected chain up to target, stopping before next
+    void ConnectTo(CBlockIndex *target, CBlockIndex *next) {
+        CValidationState state;
+        {
+            LOCK(cs_main);
+            ResetBlockFailureFlags(target);
+            if (next)
+                BOOST_REQUIRE(InvalidateBlock(state, Params(), next));
+        }
+        BOOST_REQUIRE(ActivateBestChain(state, Params()));
+        BOOST_REQUIRE(chainActive.Tip() == target);
+    }
+
+    void Replay(std::vector<ReplayPhase> const &phases, bool batching) {
+        CBlockIndex *tip = chainActive.Tip();
+        ForceSetArg("-batching", batching ? "1" : "0");
+
+        CValidationState state;
+        {
+            LOCK(cs_main);
+            BOOST_REQUIRE(InvalidateBlock(state, Params(), phases.front().first));
+        }
+        BOOST_REQUIRE(ActivateBestChain(state, Params()));
+
+        for (auto const &phase : phases) {
+            ConnectTo(phase.first->pprev, phase.first);
+
+            // Start from a cold signature cache, like a syncing node
+            InitSignatureCache();
+
+            int64_t nStart = GetTimeMicros();
+            ConnectTo(phase.last, tip->GetAncestor(phase.last->nHeight + 1));
+            int64_t nElapsed = GetTimeMicros() - nStart;
+
+            size_t blocks = phase.last->nHeight - phase.first->nHeight + 1;
+            BOOST_TEST_MESSAGE(strprintf("replay %s batching=%d: %u blocks, %u txs, %.2fms (%.2fms/block)",
+                phase.name, batching, blocks, phase.txs, nElapsed * 0.001, nElapsed * 0.001 / blocks));
+        }
+
+        ConnectTo(tip, nullptr);
+    }
+
+    void RunReplay(ReplayMix const &mix) {
+        std::vector<ReplayPhase> phases;
+
+        // Sigma mints are accepted between the sigma and lelantus start blocks
+        GenerateBlocks(250 - chainActive.Height());
+        phases.push_back(BuildPhase("sigma", mix.blocks, mix.transparent,
+            [&]() { return SigmaMints(mix.sigmaMints); }));
+
+        GenerateBlocks(::Params().GetConsensus().nLelantusStartBlock - chainActive.Height());
+        phases.push_back(BuildPhase("lelantus", mix.blocks, mix.transparent,
+            [&]() { return LelantusMints(mix.lelantusMints); }));
+
+        GenerateBlocks(2);
+        phases.push_back(BuildPhase("joinsplit", mix.blocks, mix.transparent,
+            [&]() { return JoinSplits(mix.joinSplits); }));
+
+        CBlockIndex *tip = chainActive.Tip();
+
+        SetMockTime(GetTime() + REPLAY_BLOCK_AGE);
+        for (bool batching : {false, true}) {
+            Replay(phases, batching);
+            BOOST_CHECK(chainActive.Tip() == tip);
+        }
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(chain_replay_tests, ChainReplaySetup)
+
+BOOST_AUTO_TEST_CASE(replay_privacy_mix)
+{
+    RunReplay({3, 4, 2, 3, 2});
+}
+
+BOOST_AUTO_TEST_SUITE_END()
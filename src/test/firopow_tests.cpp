@@ -6,6 +6,10 @@
 #include <crypto/progpow/lib/ethash/ethash-internal.hpp>
 #include <crypto/progpow/include/ethash/progpow.hpp>
 #include <crypto/progpow/helpers.hpp>
+#include <crypto/progpow.h>
+#include <arith_uint256.h>
+
+#include <thread>
 
 BOOST_FIXTURE_TEST_SUITE(firpow_tests, BasicTestingSetup)
 BOOST_AUTO_TEST_CASE(firopow_hash_and_verify) {
@@ -39,4 +43,66 @@ BOOST_AUTO_TEST_CASE(firopow_hash_and_verify) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(firopow_epoch_contexts) {
+
+    CProgPowEpochContexts contexts;
+
+    // concurrent callers share one context
+    const int nHeight = 3 * ethash::epoch_length + 1;
+    std::vector<CProgPowEpochContexts::ContextPtr> results(4);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < results.size(); i++)
+        threads.emplace_back([&, i] { results[i] = contexts.GetContext(nHeight); });
+    for (auto& t : threads)
+        t.join();
+    for (auto const& r : results) {
+        BOOST_CHECK(r == results[0]);
+        BOOST_CHECK_EQUAL(r->epoch_number, 3);
+    }
+    BOOST_CHECK(!contexts.IsReady(4));
+
+    // next epoch is built in the background close to the boundary
+    contexts.GetContext(4 * ethash::epoch_length - PROGPOW_EPOCH_PREBUILD_BLOCKS);
+    for (int i = 0; i < 600 && !contexts.IsReady(4); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    BOOST_CHECK(contexts.IsReady(4));
+
+    auto next = contexts.GetContext(4 * ethash::epoch_length);
+    BOOST_CHECK_EQUAL(next->epoch_number, 4);
+    BOOST_CHECK(contexts.IsReady(3));
+
+    // older epochs stay cached while recently used, the least recently used one is evicted
+    static_assert(PROGPOW_EPOCH_CONTEXTS_CACHED == 4, "test assumes four cached contexts");
+    contexts.GetContext(6 * ethash::epoch_length);
+    contexts.GetContext(3 * ethash::epoch_length);
+    contexts.GetContext(7 * ethash::epoch_length);
+    contexts.GetContext(8 * ethash::epoch_length);
+    BOOST_CHECK(contexts.IsReady(3) && contexts.IsReady(6) && contexts.IsReady(7) && contexts.IsReady(8));
+    BOOST_CHECK(!contexts.IsReady(4));
+    BOOST_CHECK_EQUAL(results[0]->epoch_number, 3);
+}
+
+BOOST_AUTO_TEST_CASE(firopow_verify_full) {
+
+    CProgPowHeader header{};
+    header.nVersion = 0x20000000;
+    header.hashPrevBlock = uint256S("0x3c1f3b8d6cbcd5a2c12ed1e2d7b4d3a7b1b4e0d0c8e0e1c6a87f0f6b9a1d2c3e");
+    header.nTime = 1635228000;
+    header.nBits = 0x20000fff;
+    header.nHeight = 10;
+    header.nNonce64 = 42;
+
+    uint256 final_hash = progpow_hash_full(header, header.mix_hash);
+    BOOST_CHECK(progpow_verify_full(header, final_hash));
+    BOOST_CHECK(progpow_hash_light(header) == final_hash);
+
+    // boundary below the final hash
+    arith_uint256 boundary = UintToArith256(final_hash);
+    BOOST_CHECK(!progpow_verify_full(header, ArithToUint256(boundary - 1)));
+
+    // tampered mix hash passing the boundary check
+    header.mix_hash = uint256S("0x01");
+    BOOST_CHECK(!progpow_verify_full(header, uint256S("0xffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff")));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
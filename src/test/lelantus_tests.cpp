@@ -1,5 +1,6 @@
 #include "../chainparams.h"
 #include "../lelantus.h"
+#include "../miner.h"
 #include "../script/standard.h"
 #include "../validation.h"
 #include "../wallet/coincontrol.h"
@@ -626,6 +627,83 @@ BOOST_AUTO_TEST_CASE(checktransaction)
         joinsplitTx, state, joinsplitTx.GetHash(), false, chainActive.Height(), false, true, NULL, &info));
 }
 
+BOOST_AUTO_TEST_CASE(block_template_refresh)
+{
+    GenerateBlocks(400);
+    pwalletMain->SetBroadcastTransactions(true);
+
+    std::vector<CMutableTransaction> txs;
+    GenerateMints({10 * CENT, 11 * CENT}, txs);
+    GenerateBlock(txs);
+    GenerateBlocks(10);
+
+    CWalletTx wtx;
+    pwalletMain->JoinSplitLelantus({{script, 8 * CENT, false}}, {}, wtx);
+    uint256 joinsplitHash = wtx.GetHash();
+    BOOST_CHECK(mempool.exists(joinsplitHash));
+
+    CScript scriptPubKey = CScript() << OP_TRUE;
+
+    // validating the template remembers the proofs for the next block only
+    auto first = BlockAssembler(::Params()).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK_EQUAL(first->block.vtx.size(), 2);
+    BOOST_CHECK(IsPrivacyProofVerified(joinsplitHash, chainActive.Height() + 1));
+    BOOST_CHECK(!IsPrivacyProofVerified(joinsplitHash, INT_MAX));
+
+    // a refresh selects from the mempool again, the joinsplit proof is not verified twice
+    txs.clear();
+    GenerateMints({1 * CENT}, txs);
+    BOOST_CHECK(mempool.exists(txs[0].GetHash()));
+    auto second = BlockAssembler(::Params()).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK_EQUAL(second->block.vtx.size(), 3);
+    BOOST_CHECK(second->block.vtx[1]->GetHash() == joinsplitHash || second->block.vtx[2]->GetHash() == joinsplitHash);
+    BOOST_CHECK(IsPrivacyProofVerified(joinsplitHash, chainActive.Height() + 1));
+
+    // transactions that left the mempool are dropped
+    mempool.removeRecursive(*wtx.tx);
+    auto third = BlockAssembler(::Params()).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK_EQUAL(third->block.vtx.size(), 2);
+    BOOST_CHECK(third->block.vtx[1]->GetHash() == txs[0].GetHash());
+
+    // a new tip forgets the verified proofs
+    GenerateBlocks(1);
+    BOOST_CHECK(!IsPrivacyProofVerified(joinsplitHash, chainActive.Height() + 1));
+}
+
+BOOST_AUTO_TEST_CASE(stempool_promotion)
+{
+    GenerateBlocks(400);
+    pwalletMain->SetBroadcastTransactions(true);
+
+    std::vector<CMutableTransaction> txs;
+    GenerateMints({10 * CENT, 11 * CENT}, txs);
+    GenerateBlock(txs);
+    GenerateBlocks(10);
+
+    CWalletTx wtx;
+    pwalletMain->JoinSplitLelantus({{script, 8 * CENT, false}}, {}, wtx);
+    uint256 joinsplitHash = wtx.GetHash();
+    mempool.removeRecursive(*wtx.tx);
+
+    {
+        LOCK(cs_main);
+        CValidationState state;
+
+        // accepting into the stem pool remembers the proofs for the mempool only
+        BOOST_CHECK(AcceptToMemoryPool(txpools.getStemTxPool(), state, wtx.tx, false, NULL, NULL, false, 0, false, false));
+        BOOST_CHECK(IsPrivacyProofVerified(joinsplitHash, INT_MAX));
+        BOOST_CHECK(!IsPrivacyProofVerified(joinsplitHash, chainActive.Height() + 1));
+
+        // fluffing still runs the stateful checks and accepts the transaction
+        BOOST_CHECK(AcceptToMemoryPool(mempool, state, wtx.tx, false, NULL, NULL, false, 0, false));
+        BOOST_CHECK(mempool.exists(joinsplitHash));
+    }
+
+    // a new tip forgets the verified proofs
+    GenerateBlocks(1);
+    BOOST_CHECK(!IsPrivacyProofVerified(joinsplitHash, INT_MAX));
+}
+
 BOOST_AUTO_TEST_CASE(move_to_v3_payload)
 {
     int prevHeight;
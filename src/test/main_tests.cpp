@@ -87,4 +87,23 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+BOOST_AUTO_TEST_CASE(read_raw_block)
+{
+    LOCK(cs_main);
+    const CBlockIndex* pindex = chainActive.Genesis();
+
+    // the bytes stored on disk are the network serialization of the block
+    std::vector<unsigned char> raw;
+    BOOST_CHECK(ReadRawBlockFromDisk(raw, pindex, Params().MessageStart()));
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+    BOOST_CHECK(raw == std::vector<unsigned char>(ss.begin(), ss.end()));
+
+    // blocks of another network are not served
+    CMessageHeader::MessageStartChars otherMagic = {0, 0, 0, 0};
+    BOOST_CHECK(!ReadRawBlockFromDisk(raw, pindex, otherMagic));
+}
 BOOST_AUTO_TEST_SUITE_END()
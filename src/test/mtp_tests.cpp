@@ -1,9 +1,15 @@
 #include "crypto/MerkleTreeProof/mtp.h"
+#include "crypto/MerkleTreeProof/merkle-tree.hpp"
 #include "test/test_bitcoin.h"
 #include "random.h"
+#include "streams.h"
 #include <iostream>
 #include <boost/test/unit_test.hpp>
 
+extern "C" {
+#include "crypto/MerkleTreeProof/ref.h"
+}
+
 using namespace std;
 
 struct MtpTestingSetup : public TestingSetup
@@ -40,7 +46,7 @@ BOOST_AUTO_TEST_CASE(mtp_impl_integrity_test)
     uint8_t hash_root_mtp[16];
     unsigned int nonce;
     uint64_t block_mtp[mtp::MTP_L*2][128];
-    std::deque<std::vector<uint8_t>> proof_mtp[mtp::MTP_L*3];
+    mtp::ProofArena proof_mtp;
     uint256 output;
 
     mtp::impl::mtp_hash(input, target, hash_root_mtp, nonce, block_mtp, proof_mtp,
@@ -50,6 +56,85 @@ BOOST_AUTO_TEST_CASE(mtp_impl_integrity_test)
     bool ok = mtp::impl::mtp_verify(input, target, hash_root_mtp, nonce, block_mtp,
             proof_mtp, pow_limit);
     BOOST_CHECK_MESSAGE(ok, "mtp_verify() failed");
+
+    // A bad path is caught wherever it sits in the batched checks
+    BOOST_CHECK_EQUAL(proof_mtp.size(), mtp::ProofArena::PROOFS);
+    uint8_t *root_sibling = proof_mtp.data(mtp::MTP_L*3 - 2)
+            + (proof_mtp.size(mtp::MTP_L*3 - 2) - 1) * mtp::MTP_PROOF_HASH_SIZE;
+    root_sibling[0] ^= 1;
+    BOOST_CHECK(!mtp::impl::mtp_verify(input, target, hash_root_mtp, nonce, block_mtp,
+            proof_mtp, pow_limit));
+    root_sibling[0] ^= 1;
+    BOOST_CHECK(!mtp::impl::mtp_verify(input, target, hash_root_mtp, nonce, block_mtp,
+            mtp::ProofArena(), pow_limit));
+}
+
+BOOST_AUTO_TEST_CASE(mtp_simd_kernels_test)
+{
+    // Multi-buffer BLAKE2b against the one-input functions, vectorized and not
+    for (int allow_simd = 1; allow_simd >= 0; --allow_simd) {
+        blake2b_select_implementation(allow_simd);
+        for (size_t len : {0, 1, 32, 127, 128, 129, 1024, 1500}) {
+            std::vector<uint8_t> data[4];
+            uint8_t digests[4][16], expected[16];
+            uint8_t *out[4];
+            const uint8_t *in[4];
+            for (int l = 0; l < 4; ++l) {
+                data[l].resize(len + 1);
+                GetRandBytes(data[l].data(), data[l].size());
+                out[l] = digests[l];
+                in[l] = data[l].data();
+            }
+            BOOST_CHECK_EQUAL(blake2b_4r_x4(out, 16, in, len), 0);
+            for (int l = 0; l < 4; ++l) {
+                blake2b_state state;
+                blake2b_init(&state, 16);
+                blake2b_4r_update(&state, in[l], len);
+                blake2b_4r_final(&state, expected, 16);
+                BOOST_CHECK_MESSAGE(memcmp(expected, digests[l], 16) == 0,
+                        "blake2b_4r_x4 " << blake2b_implementation() << " len " << len);
+            }
+        }
+    }
+    blake2b_select_implementation(1);
+
+    // Argon2 block function against the reference code
+    block prev, ref, next, expected;
+    uint8_t hash_zero[ARGON2_PREHASH_SEED_LENGTH];
+    GetRandBytes((unsigned char*)prev.v, sizeof(prev.v));
+    GetRandBytes((unsigned char*)ref.v, sizeof(ref.v));
+    GetRandBytes((unsigned char*)next.v, sizeof(next.v));
+    GetRandBytes(hash_zero, sizeof(hash_zero));
+    for (int with_xor = 0; with_xor < 2; ++with_xor) {
+        expected = next;
+        fill_block_mtp_ref(&prev, &ref, &expected, with_xor, 12345, hash_zero);
+        block result = next;
+        fill_block_mtp(&prev, &ref, &result, with_xor, 12345, hash_zero);
+        BOOST_CHECK(memcmp(expected.v, result.v, sizeof(result.v)) == 0);
+    }
+
+    // Batched Merkle paths against the one-path check
+    MerkleTree::Elements elements;
+    for (int i = 0; i < 32; ++i) {
+        uint256 rand = GetRandHash();
+        elements.push_back(MerkleTree::Buffer(rand.begin(), rand.begin() + MERKLE_TREE_ELEMENT_SIZE_B));
+    }
+    MerkleTree tree(elements, true);
+    mtp::ProofArena paths;
+    for (size_t i = 0; i < elements.size(); ++i) {
+        MerkleTree::Elements path = tree.getProofOrdered(elements[i], i + 1);
+        BOOST_CHECK(MerkleTree::checkProofOrdered(path, tree.getRoot(), elements[i], i + 1));
+        paths.push_back(path);
+    }
+    std::vector<MerkleTree::OrderedProof> proofs;
+    for (size_t i = 0; i < elements.size(); ++i) {
+        proofs.push_back({paths.data(i), paths.size(i), elements[i].data(), i + 1});
+    }
+    BOOST_CHECK_EQUAL(MerkleTree::checkProofsOrdered(proofs.data(), proofs.size(), tree.getRoot()), proofs.size());
+    proofs[22].index = 23 + 1;
+    elements[30][3] ^= 1;
+    BOOST_CHECK_EQUAL(MerkleTree::checkProofsOrdered(proofs.data(), proofs.size(), tree.getRoot()), 22);
+    BOOST_CHECK_EQUAL(MerkleTree::checkProofsOrdered(&proofs[23], proofs.size() - 23, tree.getRoot()), 30 - 23);
 }
 
 
@@ -86,6 +171,15 @@ BOOST_AUTO_TEST_CASE(mtp_block_integrity_test)
     BOOST_CHECK(block1.nNonce != block3.nNonce);
 
     BOOST_CHECK(mtp::verify(block1.nNonce, block1, pow_limit));
+
+    // The proofs survive a round trip through the flat serialization
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << *block1.mtpHashData;
+    CBlock block4(block1);
+    block4.mtpHashData = std::make_shared<CMTPHashData>();
+    stream >> *block4.mtpHashData;
+    BOOST_CHECK(stream.empty());
+    BOOST_CHECK(mtp::verify(block4.nNonce, block4, pow_limit));
     BOOST_CHECK(mtp::verify(block2.nNonce, block2, pow_limit));
     BOOST_CHECK(mtp::verify(block3.nNonce, block3, pow_limit));
 
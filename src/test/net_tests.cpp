@@ -11,6 +11,8 @@
 #include "net.h"
 #include "netbase.h"
 #include "chainparams.h"
+#include "net_processing.h"
+#include "primitives/transaction.h"
 
 class CAddrManSerializationMock : public CAddrMan
 {
@@ -172,4 +174,119 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(getaddr_response_cache)
+{
+    CConnman connman(0x1337, 0x1337);
+    CAddress source(LookupNumeric("252.2.2.2", 8333), NODE_NONE);
+    auto addAddresses = [&](int nFirst, int nCount) {
+        for (int i = nFirst; i < nFirst + nCount; i++) {
+            CAddress addr(LookupNumeric(strprintf("250.%d.%d.1", i / 256, i % 256).c_str(), 8333), NODE_NETWORK);
+            addr.nTime = GetAdjustedTime();
+            connman.AddNewAddress(addr, source);
+        }
+    };
+    addAddresses(0, 500);
+
+    CAddress addrPeer(LookupNumeric("1.2.3.4", 8333), NODE_NETWORK);
+    CNode node1(0, NODE_NETWORK, 0, INVALID_SOCKET, addrPeer, 0, 0, "", true, CAddress(LookupNumeric("5.5.5.5", 8168), NODE_NONE));
+    CNode node2(1, NODE_NETWORK, 0, INVALID_SOCKET, addrPeer, 1, 1, "", true, CAddress(LookupNumeric("6.6.6.6", 8168), NODE_NONE));
+    std::vector<CAddress> vAddr1 = connman.GetAddresses(&node1);
+    BOOST_CHECK(!vAddr1.empty());
+
+    // Peers connecting to the same local address get the same sample until it expires,
+    // peers connecting to another local address get their own
+    addAddresses(500, 500);
+    std::vector<CAddress> vAddr2 = connman.GetAddresses(&node1);
+    BOOST_CHECK(vAddr2 == vAddr1);
+    std::vector<CAddress> vAddr3 = connman.GetAddresses(&node2);
+    BOOST_CHECK(vAddr3.size() > vAddr1.size());
+}
+
+BOOST_AUTO_TEST_CASE(decode_message_payload)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 1000;
+    CTransaction tx(mtx);
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << tx;
+
+    // A decoded transaction matches the one read from the stream
+    CDataStream txStream(stream);
+    CDecodedPayload decoded;
+    DecodeMessage(NetMsgType::TX, txStream, decoded);
+    std::shared_ptr<const CTransaction> ptx = decoded.Get<const CTransaction>();
+    BOOST_REQUIRE(ptx);
+    BOOST_CHECK(ptx->GetHash() == tx.GetHash());
+
+    // Commands without a decoder leave the payload to the handler
+    CDataStream pingStream(stream);
+    CDecodedPayload notDecoded;
+    DecodeMessage(NetMsgType::PING, pingStream, notDecoded);
+    BOOST_CHECK(!notDecoded.Get<const CTransaction>());
+
+    // A truncated payload is reported where the handler reads it
+    CDataStream truncated(stream.begin(), stream.begin() + stream.size() / 2, SER_NETWORK, PROTOCOL_VERSION);
+    CDecodedPayload failed;
+    DecodeMessage(NetMsgType::TX, truncated, failed);
+    BOOST_CHECK_THROW(failed.Get<const CTransaction>(), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(net_msg_stats)
+{
+    CNetMsgStats stats;
+    stats.RecordProcess(NetMsgType::TX, 250, 10, 0);
+    stats.RecordProcess(NetMsgType::TX, 300, 3000, 1);
+    stats.RecordDecode(NetMsgType::TX, 5);
+    // Unknown commands do not add entries
+    stats.RecordProcess("nosuchmsg", 1 << 30, 1, 1);
+
+    std::map<std::string, CNetMsgStats::Entry> result = stats.GetStats();
+    BOOST_CHECK_EQUAL(result.size(), getAllNetMessageTypes().size() + 1);
+
+    const CNetMsgStats::Entry& tx = result[NetMsgType::TX];
+    BOOST_CHECK_EQUAL(tx.size.nCount, 2U);
+    BOOST_CHECK_EQUAL(tx.size.nSum, 550);
+    BOOST_CHECK_EQUAL(tx.size.nMax, 300);
+    BOOST_CHECK_EQUAL(tx.size.vBuckets[8], 1U);
+    BOOST_CHECK_EQUAL(tx.size.vBuckets[9], 1U);
+    BOOST_CHECK_EQUAL(tx.queue.vBuckets[4], 1U);
+    BOOST_CHECK_EQUAL(tx.queue.vBuckets[12], 1U);
+    BOOST_CHECK_EQUAL(tx.process.vBuckets[0], 1U);
+    BOOST_CHECK_EQUAL(tx.process.vBuckets[1], 1U);
+    BOOST_CHECK_EQUAL(tx.decode.nCount, 1U);
+
+    // Values beyond the last bucket are kept in it
+    const CNetMsgStats::Entry& other = result["*other*"];
+    BOOST_CHECK_EQUAL(other.size.vBuckets[CNetMsgStats::HISTOGRAM_BUCKETS - 1], 1U);
+}
+
+BOOST_AUTO_TEST_CASE(dandelion_embargo_queue)
+{
+    int64_t nNow = GetTimeMicros();
+    uint256 expired = GetRandHash(), pending = GetRandHash(), lifted = GetRandHash();
+
+    BOOST_CHECK(CNode::insertDandelionEmbargo(expired, nNow - 1000000));
+    BOOST_CHECK(CNode::insertDandelionEmbargo(pending, nNow + 3600 * 1000000LL));
+    BOOST_CHECK(CNode::insertDandelionEmbargo(lifted, nNow - 1000000));
+    BOOST_CHECK(!CNode::insertDandelionEmbargo(pending, nNow));
+    BOOST_CHECK(CNode::removeDandelionEmbargo(lifted));
+
+    // An embargo lifted and set again only expires at its new time
+    BOOST_CHECK(CNode::insertDandelionEmbargo(lifted, nNow + 3600 * 1000000LL));
+
+    // Expired transactions that are in neither pool are dropped
+    CNode::CheckDandelionEmbargoes();
+    BOOST_CHECK(!CNode::isTxDandelionEmbargoed(expired));
+    BOOST_CHECK(CNode::isTxDandelionEmbargoed(pending));
+    BOOST_CHECK(CNode::isTxDandelionEmbargoed(lifted));
+
+    BOOST_CHECK(CNode::removeDandelionEmbargo(pending));
+    BOOST_CHECK(CNode::removeDandelionEmbargo(lifted));
+    BOOST_CHECK(!CNode::isTxDandelionEmbargoed(pending));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 #include "utilmoneystr.h"
 #include "validation.h"
 #include "validationinterface.h"
+#include "pow.h"
 #include "test/test_bitcoin.h"
 #include "script/standard.h"
 #include <consensus/merkle.h>
@@ -60,6 +61,38 @@ struct ProgpowTestingSetup : public TestChain100Setup
 
         return correctError == validationInterface.errorCode;
     }
+
+    // Builds headers on top of the tip, the one at badIndex fails the PoW check. For ProgPoW
+    // that header only passes the light check, its mix_hash is bogus
+    std::vector<CBlockHeader> BuildHeaders(size_t count, size_t badIndex) {
+        const Consensus::Params &params = Params().GetConsensus();
+        const CBlockIndex *tip = chainActive.Tip();
+        std::vector<CBlockHeader> headers;
+        uint256 hashPrev = tip->GetBlockHash();
+        for (size_t i = 0; i < count; i++) {
+            CBlockHeader header;
+            header.nVersion = tip->nVersion;
+            header.hashPrevBlock = hashPrev;
+            header.hashMerkleRoot = GetRandHash();
+            header.nTime = tip->GetMedianTimePast() + 1 + i;
+            header.nBits = GetNextWorkRequired(tip, &header, params);
+            header.nHeight = tip->nHeight + 1 + i;
+            if (!header.IsProgPow())
+                while (CheckProofOfWork(header.GetHash(), header.nBits, params) != (i != badIndex))
+                    header.nNonce++;
+            else if (i != badIndex)
+                while (!CheckProofOfWork(header.GetProgPowHashFull(header.mix_hash), header.nBits, params))
+                    header.nNonce64++;
+            else {
+                header.mix_hash = GetRandHash();
+                while (!CheckProofOfWork(header.GetProgPowHashLight(), header.nBits, params))
+                    header.nNonce64++;
+            }
+            hashPrev = header.GetHash();
+            headers.push_back(header);
+        }
+        return headers;
+    }
 };
 
 
@@ -135,4 +168,48 @@ BOOST_AUTO_TEST_CASE(corruption)
     BOOST_ASSERT(VerifyBlockCheckStatus(block, ""));
 }
 
+BOOST_AUTO_TEST_CASE(headers_batch)
+{
+    // a header failing PoW in the middle of a batch gets the usual DoS score, the ones before it are accepted
+    std::vector<CBlockHeader> headers = BuildHeaders(20, 12);
+    CValidationState state;
+    int nDoS = 0;
+    BOOST_CHECK(!ProcessNewBlockHeaders(headers, state, Params()));
+    BOOST_CHECK(state.IsInvalid(nDoS));
+    BOOST_CHECK_EQUAL(nDoS, 50);
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    for (size_t i = 0; i < headers.size(); i++)
+        BOOST_CHECK_EQUAL(mapBlockIndex.count(headers[i].GetHash()), i < 12 ? 1 : 0);
+
+    headers = BuildHeaders(20, headers.size());
+    state = CValidationState();
+    BOOST_CHECK(ProcessNewBlockHeaders(headers, state, Params()));
+    BOOST_CHECK(mapBlockIndex.count(headers.back().GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(full_headers_check)
+{
+    mutableParams.nPPSwitchTime = (uint32_t)(chainActive.Tip()->GetMedianTimePast()+1);
+
+    std::vector<CBlockHeader> headers = BuildHeaders(4, 2);
+    BOOST_ASSERT(headers[0].IsProgPow());
+
+    // the bogus mix_hash passes the light check
+    CValidationState state;
+    BOOST_CHECK(ProcessNewBlockHeaders(headers, state, Params()));
+
+    headers = BuildHeaders(4, 2);
+    fFullProgPowHeaders = true;
+    int nDoS = 0;
+    BOOST_CHECK(!ProcessNewBlockHeaders(headers, state, Params()));
+    fFullProgPowHeaders = DEFAULT_FULL_PROGPOW_HEADERS;
+    BOOST_CHECK(state.IsInvalid(nDoS));
+    BOOST_CHECK_EQUAL(nDoS, 50);
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "invalid-mixhash");
+    BOOST_CHECK(mapBlockIndex.count(headers[1].GetHash()));
+    BOOST_CHECK(!mapBlockIndex.count(headers[2].GetHash()));
+    // ConnectBlock skips the full hash of headers verified here
+    BOOST_CHECK(mapBlockIndex[headers[1].GetHash()]->fProgPowVerified);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
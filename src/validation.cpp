@@ -72,7 +72,11 @@
 #include "llmq/quorums_instantsend.h"
 #include "llmq/quorums_chainlocks.h"
 
+#include "ctpl.h"
+
 #include <atomic>
+#include <deque>
+#include <unordered_set>
 #include <sstream>
 #include <chrono>
 
@@ -115,6 +119,7 @@ bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fFullProgPowHeaders = DEFAULT_FULL_PROGPOW_HEADERS;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
@@ -578,6 +583,63 @@ int GetUTXOConfirmations(const COutPoint& outpoint)
     return (nPrevoutHeight > -1 && chainActive.Tip()) ? chainActive.Height() - nPrevoutHeight + 1 : -1;
 }
 
+namespace {
+    /** Contexts a privacy proof verification result applies to */
+    enum PrivacyProofContext : uint8_t {
+        PRIVACY_PROOF_BLOCK = 1,   //!< the block on top of the tip
+        PRIVACY_PROOF_MEMPOOL = 2, //!< the stem pool and the mempool (nHeight == INT_MAX)
+    };
+
+    /** Transactions whose privacy proofs verified on top of hashPrivacyProofTip, with the contexts they verified in */
+    CCriticalSection cs_privacyProofVerified;
+    uint256 hashPrivacyProofTip;
+    std::unordered_map<uint256, uint8_t, BlockHasher> mapPrivacyProofVerified;
+}
+
+// Proofs verified against the mempool (nHeight == INT_MAX) use the newest rules and
+// are not reused for blocks, so the two contexts are remembered separately
+static bool GetPrivacyProofTip(int nHeight, uint256& hashTip, uint8_t& context)
+{
+    CBlockIndex* pindexTip = chainActive.Tip();
+    if (!pindexTip)
+        return false;
+    if (nHeight == INT_MAX)
+        context = PRIVACY_PROOF_MEMPOOL;
+    else if (nHeight == pindexTip->nHeight + 1)
+        context = PRIVACY_PROOF_BLOCK;
+    else
+        return false;
+    hashTip = pindexTip->GetBlockHash();
+    return true;
+}
+
+bool IsPrivacyProofVerified(const uint256& hashTx, int nHeight)
+{
+    uint256 hashTip;
+    uint8_t context;
+    if (!GetPrivacyProofTip(nHeight, hashTip, context))
+        return false;
+    LOCK(cs_privacyProofVerified);
+    if (hashPrivacyProofTip != hashTip)
+        return false;
+    auto it = mapPrivacyProofVerified.find(hashTx);
+    return it != mapPrivacyProofVerified.end() && (it->second & context);
+}
+
+void SetPrivacyProofVerified(const uint256& hashTx, int nHeight)
+{
+    uint256 hashTip;
+    uint8_t context;
+    if (!GetPrivacyProofTip(nHeight, hashTip, context))
+        return;
+    LOCK(cs_privacyProofVerified);
+    if (hashPrivacyProofTip != hashTip || mapPrivacyProofVerified.size() >= MAX_PRIVACY_PROOF_VERIFIED_TXS) {
+        mapPrivacyProofVerified.clear();
+        hashPrivacyProofTip = hashTip;
+    }
+    mapPrivacyProofVerified[hashTx] |= context;
+}
+
 bool CheckTransaction(const CTransaction &tx, CValidationState &state, bool fCheckDuplicateInputs, uint256 hashTx,  bool isVerifyDB, int nHeight, bool isCheckWallet, bool fStatefulZerocoinCheck, sigma::CSigmaTxInfo *sigmaTxInfo, lelantus::CLelantusTxInfo* lelantusTxInfo)
 {
     LogPrintf("CheckTransaction nHeight=%s, isVerifyDB=%s, isCheckWallet=%s, txHash=%s\n", nHeight, isVerifyDB, isCheckWallet, tx.GetHash().ToString());
@@ -1456,6 +1518,9 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
 
     if(tx.IsLelantusMint() && !GetBoolArg("-disablewallet", false) && pwalletMain->zwallet) {
         LogPrintf("Updating mint state from Mempool..\n");
+        // JMint amounts are decrypted in one batch, indexes point into lelantusAmounts
+        std::vector<std::pair<std::vector<unsigned char>, GroupElement>> encryptedValues;
+        std::vector<size_t> encryptedIndexes;
         BOOST_FOREACH(const CTxOut &txout, tx.vout)
         {
             if (txout.scriptPubKey.IsLelantusMint() || txout.scriptPubKey.IsLelantusJMint()) {
@@ -1468,8 +1533,8 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
                     } else {
                         std::vector<unsigned char> encryptedValue;
                         lelantus::ParseLelantusJMintScript(txout.scriptPubKey, pubCoinValue, encryptedValue);
-                        if(!pwalletMain->DecryptMintAmount(encryptedValue, pubCoinValue, amount))
-                            amount = 0;
+                        encryptedValues.emplace_back(std::move(encryptedValue), pubCoinValue);
+                        encryptedIndexes.push_back(lelantusAmounts.size());
                     }
                 } catch (std::invalid_argument&) {
                     return state.DoS(100, false, PUBCOIN_NOT_VALIDATE, "bad-txns-zerocoin");
@@ -1477,6 +1542,12 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
                 lelantusAmounts.push_back(amount);
             }
         }
+        if (!encryptedValues.empty()) {
+            std::vector<uint64_t> amounts;
+            pwalletMain->DecryptMintAmounts(encryptedValues, amounts);
+            for (size_t i = 0; i < amounts.size(); i++)
+                lelantusAmounts[encryptedIndexes[i]] = amounts[i];
+        }
         pwalletMain->zwallet->GetTracker().UpdateLelantusMintStateFromMempool(lelantusMintPubcoins, lelantusAmounts);
     }
 #endif
@@ -1697,6 +1768,36 @@ bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex, const Consensus
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart)
+{
+    // Step back over the message start and size written in front of the block
+    CDiskBlockPos pos = pindex->GetBlockPos();
+    CDiskBlockPos hpos = pos;
+    hpos.nPos -= CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("ReadRawBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars blkStart;
+        unsigned int nSize;
+        filein >> FLATDATA(blkStart) >> nSize;
+
+        if (memcmp(blkStart, messageStart, CMessageHeader::MESSAGE_START_SIZE))
+            return error("ReadRawBlockFromDisk: Block magic mismatch at %s", pos.ToString());
+        if (nSize > MAX_SIZE)
+            return error("ReadRawBlockFromDisk: Block size %u too large at %s", nSize, pos.ToString());
+
+        block.resize(nSize);
+        filein.read((char*)block.data(), nSize);
+    }
+    catch (const std::exception &e) {
+        return error("%s: Read from block file failed - %s at %s", __func__, e.what(), pos.ToString());
+    }
+
+    return true;
+}
+
 bool ReadBlockHeaderFromDisk(CBlock &block, const CDiskBlockPos &pos) {
     CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
@@ -2545,6 +2646,161 @@ public:
 // Protected by cs_main
 static ThresholdConditionCache warningcache[VERSIONBITS_NUM_BITS];
 
+namespace {
+    /** Results of -fullprogpowheaders verification, keyed by block hash */
+    CCriticalSection cs_progPowVerified;
+    std::unordered_map<uint256, bool, BlockHasher> mapProgPowVerified;
+    std::deque<uint256> progPowVerifiedOrder;
+}
+
+static bool LookupProgPowVerified(const uint256& hash, bool& fValid)
+{
+    LOCK(cs_progPowVerified);
+    auto it = mapProgPowVerified.find(hash);
+    if (it == mapProgPowVerified.end())
+        return false;
+    fValid = it->second;
+    return true;
+}
+
+static void CacheProgPowVerified(const uint256& hash, bool fValid)
+{
+    LOCK(cs_progPowVerified);
+    if (!mapProgPowVerified.emplace(hash, fValid).second)
+        return;
+    progPowVerifiedOrder.push_back(hash);
+    while (progPowVerifiedOrder.size() > MAX_PROGPOW_VERIFIED_HEADERS) {
+        mapProgPowVerified.erase(progPowVerifiedOrder.front());
+        progPowVerifiedOrder.pop_front();
+    }
+}
+
+/**
+ * Runs progpow::verify on the header against the target encoded in nBits, DAG loops implied.
+ * Headers failing the light hash check are rejected before the epoch context is touched.
+ */
+static bool VerifyProgPowHeader(const CBlockHeader& block, const Consensus::Params& consensusParams)
+{
+    if (!CheckProofOfWork(block.GetProgPowHashLight(), block.nBits, consensusParams))
+        return false;
+
+    bool fNegative, fOverflow;
+    arith_uint256 bnTarget;
+    bnTarget.SetCompact(block.nBits, &fNegative, &fOverflow);
+    if (fNegative || fOverflow || bnTarget == 0)
+        return false;
+    return progpow_verify_full(block.GetProgPowHeader(), ArithToUint256(bnTarget));
+}
+
+/**
+ * Checks the proof of work of a headers batch on a worker pool ahead of the serial
+ * AcceptBlockHeader calls, which then find the hashes cached in the headers (and the
+ * -fullprogpowheaders results in mapProgPowVerified). Nothing is rejected here, so a bad
+ * header still fails in CheckBlockHeader with the usual DoS score. Only headers chaining
+ * from a known block are checked, with the heights they will get in the index, and work
+ * past the first failing header is skipped. ProgPoW headers are full-verified only after
+ * passing the light hash check. The workers are shared by all batches.
+ */
+/** Workers checking header batches, created on first use and kept for the life of the process */
+static ctpl::thread_pool& GetHeaderCheckPool()
+{
+    static std::once_flag once;
+    static std::unique_ptr<ctpl::thread_pool> pool;
+    std::call_once(once, []() {
+        pool.reset(new ctpl::thread_pool(GetNumCores()));
+        RenameThreadPool(*pool, "firo-powcheck");
+    });
+    return *pool;
+}
+
+static void CheckHeadersPoW(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams)
+{
+    struct HeaderToCheck {
+        const CBlockHeader* header;
+        uint256 hash;
+        int nHeight;
+    };
+    std::vector<HeaderToCheck> toCheck;
+    {
+        LOCK(cs_main);
+        BlockMap::iterator mi = mapBlockIndex.find(headers.front().hashPrevBlock);
+        if (mi == mapBlockIndex.end())
+            return;
+        int nHeight = mi->second->nHeight;
+        uint256 hashPrev = headers.front().hashPrevBlock;
+        bool fDummy;
+        for (const CBlockHeader& header : headers) {
+            if (header.hashPrevBlock != hashPrev)
+                break;
+            hashPrev = header.GetHash();
+            nHeight++;
+            if (mapBlockIndex.count(hashPrev))
+                continue;
+            if (header.IsProgPow()) {
+                // the light hash CheckBlockHeader uses is cheap, only the full verification is worth doing ahead
+                if (!fFullProgPowHeaders || LookupProgPowVerified(hashPrev, fDummy))
+                    continue;
+                // a peer can't make us build light caches for arbitrary epochs
+                if ((int)header.nHeight != nHeight || nHeight >= progpow::epoch_length*2000)
+                    break;
+                // nor make us run full hashes of headers failing the cheap light check,
+                // the serial path rejects them and everything after them
+                if (!CheckProofOfWork(header.GetProgPowHashLight(), header.nBits, consensusParams))
+                    break;
+            } else if (header.IsMTP()) {
+                // the header carries its MTP hash, the proof comes with the block
+                continue;
+            }
+            toCheck.push_back({&header, hashPrev, nHeight});
+        }
+    }
+    if (toCheck.size() < 2)
+        return;
+
+    std::atomic<size_t> nFirstFailure(toCheck.size());
+    ctpl::thread_pool& workerPool = GetHeaderCheckPool();
+    std::vector<std::future<void>> futures;
+    futures.reserve(toCheck.size());
+    for (size_t i = 0; i < toCheck.size(); i++) {
+        futures.emplace_back(workerPool.push([&, i](int) {
+            if (i > nFirstFailure)
+                return;
+            const HeaderToCheck& entry = toCheck[i];
+            bool fValid;
+            if (entry.header->IsProgPow()) {
+                fValid = VerifyProgPowHeader(*entry.header, consensusParams);
+                CacheProgPowVerified(entry.hash, fValid);
+            } else {
+                // GetPoWHash caches the hash in the header for CheckBlockHeader
+                fValid = CheckProofOfWork(entry.header->GetPoWHash(entry.nHeight), entry.header->nBits, consensusParams);
+            }
+            size_t nPrevFailure = nFirstFailure;
+            while (!fValid && i < nPrevFailure && !nFirstFailure.compare_exchange_weak(nPrevFailure, i))
+                ;
+        }));
+    }
+    for (auto& f : futures)
+        f.get();
+}
+
+/** Contextual -fullprogpowheaders check of a header, uses the result cached by CheckHeadersPoW if any */
+static bool CheckProgPowHeaderFull(const CBlockHeader& block, const uint256& hash, int nHeight, const Consensus::Params& consensusParams, CValidationState& state)
+{
+    if ((int)block.nHeight != nHeight)
+        return state.DoS(100, false, REJECT_INVALID, "bad-blk-progpow", false, "ProgPOW height doesn't match chain height");
+    if (block.nHeight >= progpow::epoch_length*2000)
+        return state.DoS(50, false, REJECT_INVALID, "invalid-progpow-epoch", false, "invalid epoch number");
+
+    bool fValid;
+    if (!LookupProgPowVerified(hash, fValid)) {
+        fValid = VerifyProgPowHeader(block, consensusParams);
+        CacheProgPowVerified(hash, fValid);
+    }
+    if (!fValid)
+        return state.DoS(50, false, REJECT_INVALID, "invalid-mixhash", false, "mix_hash validity failed");
+    return true;
+}
+
 static int64_t nTimeCheck = 0;
 static int64_t nTimeForks = 0;
 static int64_t nTimeVerify = 0;
@@ -2577,17 +2833,21 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (block.nHeight >= progpow::epoch_length*2000)
             return state.DoS(50, false, REJECT_INVALID, "invalid-progpow-epoch", false, "invalid epoch number");
 
-        uint256 exp_mix_hash, final_hash;
-        final_hash = block.GetProgPowHashFull(exp_mix_hash);
-        if (exp_mix_hash != block.mix_hash)
+        // the header may have been fully verified already with -fullprogpowheaders
+        if (!pindex->fProgPowVerified)
         {
-            return state.DoS(50, false, REJECT_INVALID, "invalid-mixhash", false, "mix_hash validity failed");
-        }
+            uint256 exp_mix_hash, final_hash;
+            final_hash = block.GetProgPowHashFull(exp_mix_hash);
+            if (exp_mix_hash != block.mix_hash)
+            {
+                return state.DoS(50, false, REJECT_INVALID, "invalid-mixhash", false, "mix_hash validity failed");
+            }
 
-        // This check is redundand but for the piece of mind we are leaving it here
-        if (!CheckProofOfWork(final_hash, block.nBits, chainparams.GetConsensus()))
-        {
-            return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
+            // This check is redundand but for the piece of mind we are leaving it here
+            if (!CheckProofOfWork(final_hash, block.nBits, chainparams.GetConsensus()))
+            {
+                return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
+            }
         }
     }
 
@@ -2737,7 +2997,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     bool isMainNet = chainparams.GetConsensus().IsMain();
     // batch verify Lelantus/Sigma if block is older than a day, that means we are syncing or reindexing
     BatchProofContainer* batchProofContainer = BatchProofContainer::get_instance();
-    batchProofContainer->fCollectProofs = ((GetSystemTimeInSeconds() - pindex->GetBlockTime()) > 86400) && GetBoolArg("-batching", true);
+    batchProofContainer->fCollectProofs = ((GetTime() - pindex->GetBlockTime()) > 86400) && GetBoolArg("-batching", true);
     batchProofContainer->init();
 
     block.sigmaTxInfo = std::make_shared<sigma::CSigmaTxInfo>();
@@ -3964,7 +4224,7 @@ bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams,
         }
         // Do batch verification if we reach 1 day old block,
         BatchProofContainer* batchProofContainer = BatchProofContainer::get_instance();
-        batchProofContainer->fCollectProofs = ((GetSystemTimeInSeconds() - pindexNewTip->GetBlockTime()) > 86400) && GetBoolArg("-batching", true);
+        batchProofContainer->fCollectProofs = ((GetTime() - pindexNewTip->GetBlockTime()) > 86400) && GetBoolArg("-batching", true);
         batchProofContainer->verify();
 
         // When we reach this point, we switched to a new tip (stored in pindexNewTip).
@@ -4686,6 +4946,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
     uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = NULL;
+    bool fProgPowVerified = false;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
 
         if (miSelf != mapBlockIndex.end()) {
@@ -4716,9 +4977,17 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
 
         if (!ContextualCheckBlockHeader(block, state, chainparams.GetConsensus(), pindexPrev, GetAdjustedTime()))
             return error("%s: Consensus::ContextualCheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
+
+        if (fFullProgPowHeaders && block.IsProgPow()) {
+            if (!CheckProgPowHeaderFull(block, hash, pindexPrev->nHeight + 1, chainparams.GetConsensus(), state))
+                return error("%s: CheckProgPowHeaderFull: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
+            fProgPowVerified = true;
+        }
     }
     if (pindex == NULL)
         pindex = AddToBlockIndex(block);
+    if (fProgPowVerified)
+        pindex->fProgPowVerified = true;
 
     if (ppindex)
         *ppindex = pindex;
@@ -4734,6 +5003,9 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex)
 {
+    if (!headers.empty())
+        CheckHeadersPoW(headers, chainparams.GetConsensus());
+
     {
         LOCK(cs_main);
         for (const CBlockHeader& header : headers) {
@@ -141,6 +141,16 @@ static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 /** Default for -permitbaremultisig */
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
+/** Default for -fullprogpowheaders, fully verify ProgPoW mix hashes of received headers */
+static const bool DEFAULT_FULL_PROGPOW_HEADERS = false;
+/**
+ * Maximum number of full ProgPoW header verification results kept between the parallel
+ * batch check and AcceptBlockHeader, two full headers messages. Accepted headers keep
+ * theirs in CBlockIndex::fProgPowVerified until ConnectBlock.
+ */
+static const unsigned int MAX_PROGPOW_VERIFIED_HEADERS = 4000;
+/** Maximum number of transactions whose Sigma/Lelantus proofs are remembered as verified on the current tip */
+static const unsigned int MAX_PRIVACY_PROOF_VERIFIED_TXS = 10000;
 static const bool DEFAULT_TXINDEX = true;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const bool DEFAULT_ADDRESSINDEX = false;
@@ -199,6 +209,7 @@ extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+extern bool fFullProgPowHeaders;
 //extern int nBestHeight;
 
 // Settings
@@ -425,6 +436,19 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
 
 /** Transaction validation functions */
 
+/**
+ * Sigma/Lelantus proof verification results on top of the current tip.
+ * A transaction fully verified in a block at nHeight == tip height + 1 (a block
+ * template or the block connected next) does not have its proofs verified again
+ * in that context. Likewise a transaction verified for the stem pool
+ * (nHeight == INT_MAX) is not verified again when Dandelion fluffs it into the
+ * mempool, as both pools check against the same anonymity sets. Serials and all
+ * other stateful checks still run. The results are dropped whenever the tip
+ * changes, so a promotion after a new block verifies the proofs in full.
+ */
+bool IsPrivacyProofVerified(const uint256& hashTx, int nHeight);
+void SetPrivacyProofVerified(const uint256& hashTx, int nHeight);
+
 /** Context-independent validity checks */
 bool CheckTransaction(const CTransaction& tx, CValidationState& state, bool fCheckDuplicateInputs, uint256 hashTx, bool isVerifyDB, int nHeight = INT_MAX, bool isCheckWallet = false, bool fStatefulZerocoinCheck = true, sigma::CSigmaTxInfo *sigmaTxInfo = NULL, lelantus::CLelantusTxInfo* lelantusTxInfo = NULL);
 
@@ -536,6 +560,8 @@ bool GetAddressUnspent(uint160 addressHash, AddressType type,
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, int nHeight, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read the serialized block of pindex as stored on disk, skipping deserialization and the proof of work check */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart);
 
 /** Functions for validating blocks and updating the block tree */
 
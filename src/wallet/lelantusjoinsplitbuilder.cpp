@@ -121,8 +121,7 @@ CWalletTx LelantusJoinSplitBuilder::Build(
     }
 
     std::list<CSigmaEntry> sigmaCoins = pwalletMain->GetAvailableCoins(coinControl);
-    std::list<CLelantusEntry> coins = pwalletMain->GetAvailableLelantusCoins(coinControl);
-    std::tie(fee, std::ignore) = wallet.EstimateJoinSplitFee(vOut + mint, recipientsToSubtractFee, sigmaCoins, coins, coinControl);
+    std::tie(fee, std::ignore) = wallet.EstimateJoinSplitFee(vOut + mint, recipientsToSubtractFee, sigmaCoins, coinControl);
 
     for (;;) {
         // In case of not enough fee, reset mint seed counter
@@ -213,7 +212,7 @@ CWalletTx LelantusJoinSplitBuilder::Build(
         }
 
         if(required > 0) {
-            if (!wallet.GetCoinsToJoinSplit(required, spendCoins, changeToMint, coins,
+            if (!wallet.GetCoinsToJoinSplit(required, spendCoins, changeToMint,
                                             consensusParams.nMaxLelantusInputPerTransaction,
                                             consensusParams.nMaxValueLelantusSpendPerTransaction, coinControl)) {
                 throw InsufficientFunds();
@@ -299,4 +299,29 @@ BOOST_AUTO_TEST_CASE(spend)
     lelantus::CLelantusState::GetState()->Reset();
 }
 
+BOOST_AUTO_TEST_CASE(decrypt_mint_amounts)
+{
+    std::vector<uint64_t> expected = {1 * COIN, 0, 21 * COIN, 1 * COIN};
+    std::vector<std::pair<std::vector<unsigned char>, secp_primitives::GroupElement>> encrypted;
+    for (auto amount : expected) {
+        lelantus::PrivateCoin coin(params, amount);
+        auto pubcoin = coin.getPublicCoin().getValue();
+        encrypted.emplace_back(pwalletMain->EncryptMintAmount(amount, pubcoin), pubcoin);
+    }
+
+    std::vector<uint64_t> amounts;
+    BOOST_CHECK(pwalletMain->DecryptMintAmounts(encrypted, amounts));
+    BOOST_CHECK(expected == amounts);
+
+    uint64_t amount;
+    BOOST_CHECK(pwalletMain->DecryptMintAmount(encrypted[2].first, encrypted[2].second, amount));
+    BOOST_CHECK_EQUAL(expected[2], amount);
+
+    // malformed value does not affect the others
+    encrypted[1].first.resize(8);
+    BOOST_CHECK(!pwalletMain->DecryptMintAmounts(encrypted, amounts));
+    BOOST_CHECK_EQUAL(0U, amounts[1]);
+    BOOST_CHECK_EQUAL(expected[3], amounts[3]);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -348,6 +348,7 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
     AssertLockHeld(cs_wallet); // mapKeyMetadata
     if (!CCryptoKeyStore::AddKeyPubKey(secret, pubkey))
         return false;
+    nKeyStoreUpdateCounter++;
 
     // check if we need to remove from watch-only
     CScript script;
@@ -418,6 +419,7 @@ bool CWallet::AddCScript(const CScript& redeemScript)
 {
     if (!CCryptoKeyStore::AddCScript(redeemScript))
         return false;
+    nKeyStoreUpdateCounter++;
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteCScript(Hash160(redeemScript), redeemScript);
@@ -443,6 +445,7 @@ bool CWallet::AddWatchOnly(const CScript& dest)
 {
     if (!CCryptoKeyStore::AddWatchOnly(dest))
         return false;
+    nKeyStoreUpdateCounter++;
     const CKeyMetadata& meta = mapKeyMetadata[CScriptID(dest)];
     UpdateTimeFirstKey(meta.nCreateTime);
     NotifyWatchonlyChanged(true);
@@ -1762,6 +1765,35 @@ bool CWallet::IsMine(const CTransaction& tx) const
     return false;
 }
 
+bool CWallet::IsPotentiallyMine(const CTransaction& tx, CWalletDB& walletdb) const
+{
+    // Spends are matched by serial which needs the spend proof parsed; they are
+    // rare enough to leave to AddToWalletIfInvolvingMe
+    if (tx.IsSigmaSpend() || tx.IsLelantusJoinSplit())
+        return true;
+
+    for (const CTxOut& txout : tx.vout) {
+        const CScript& script = txout.scriptPubKey;
+        if (script.IsSigmaMint() || script.IsLelantusMint() || script.IsLelantusJMint()) {
+            secp_primitives::GroupElement pub;
+            try {
+                if (script.IsSigmaMint()) {
+                    pub = sigma::ParseSigmaMintScript(script);
+                } else {
+                    lelantus::ParseLelantusMintScript(script, pub);
+                }
+            } catch (std::invalid_argument &) {
+                continue;
+            }
+            if (walletdb.HasHDMint(pub))
+                return true;
+        } else if (::IsMine(*this, script) != ISMINE_NO) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool CWallet::IsFromMe(const CTransaction& tx) const
 {
     return (GetDebit(tx, ISMINE_ALL) > 0);
@@ -1933,6 +1965,8 @@ bool CWallet::SetHDChain(const CHDChain &chain, bool memonly, bool& upgradeChain
             throw std::runtime_error(std::string(__func__) + ": writing chain failed");
         hdChain = chain;
     }
+    // mint value keys are derived from the chain's master key
+    ClearMintValueKeys();
 
     return true;
 }
@@ -2143,11 +2177,47 @@ void CWalletTx::GetAmounts(std::list<COutputEntry>& listReceived,
 
 }
 
+namespace {
+
+/** A block read from disk and pre-filtered by a rescan worker */
+struct CRescanBlock
+{
+    CBlock block;
+    bool fRead = false;
+    //! IsPotentiallyMine() result for each transaction of the block
+    std::vector<bool> vPotentiallyMine;
+};
+
+typedef std::shared_ptr<const CRescanBlock> CRescanBlockRef;
+
+/** A block handed to the rescan workers, in chain order */
+struct CRescanPending
+{
+    CBlockIndex* pindex;
+    //! Keystore update counter at the time the block was handed out
+    uint64_t nKeyStoreUpdateCounter;
+    std::future<CRescanBlockRef> result;
+};
+
+int GetRescanThreads()
+{
+    int nThreads = GetArg("-rescanthreads", DEFAULT_RESCAN_THREADS);
+    if (nThreads <= 0)
+        nThreads = GetNumCores();
+    return std::max(1, std::min(nThreads, MAX_RESCAN_THREADS));
+}
+
+} // anon namespace
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
  *
+ * Blocks are read, checked and matched against the keystore by a pool of
+ * workers ahead of the block being applied; only the transactions which
+ * may be ours are then applied, block by block, under cs_main and cs_wallet.
+ *
  * Returns pointer to the first block in the last contiguous range that was
  * successfully scanned.
  *
@@ -2157,8 +2227,11 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex *pindexStart, bool f
     CBlockIndex* ret = nullptr;
     int64_t nNow = GetTime();
     const CChainParams& chainParams = Params();
+    const Consensus::Params& consensusParams = chainParams.GetConsensus();
 
     CBlockIndex* pindex = pindexStart;
+    double dProgressStart;
+    double dProgressTip;
     {
         LOCK2(cs_main, cs_wallet);
 
@@ -2166,7 +2239,7 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex *pindexStart, bool f
         // our wallet birthday (as adjusted for block time variability)
         // if you are recovering wallet with mnemonics start rescan from block when mnemonics implemented in Firo
         if (fRecoverMnemonic) {
-            pindex = chainActive[chainParams.GetConsensus().nMnemonicBlock];
+            pindex = chainActive[consensusParams.nMnemonicBlock];
             if (pindex == NULL)
                 pindex = chainActive.Tip();
         } else
@@ -2174,35 +2247,115 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex *pindexStart, bool f
                 pindex = chainActive.Next(pindex);
 
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
-        double dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
-        while (pindex)
-        {
-            // A temporary fix for inability to Ctrl-C rescan when restoring a wallet (will be fixed in 0.15.)
-            if (ShutdownRequested())
-                return nullptr;
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
-            }
-
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    AddToWalletIfInvolvingMe(*block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+        dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
+        dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
+    }
+
+    const int nThreads = GetRescanThreads();
+    const size_t nReadAhead = nThreads * RESCAN_BLOCKS_PER_THREAD;
+    ctpl::thread_pool workerPool(nThreads);
+    RenameThreadPool(workerPool, "firo-rescan");
+
+    std::deque<CRescanPending> pending;
+    CBlockIndex* pindexNextRead = pindex;
+
+    // Block positions are fetched here under cs_main, the workers never take it
+    // so a caller holding cs_main can not deadlock against them
+    auto readAhead = [&]() {
+        LOCK(cs_main);
+        while (pindexNextRead && pending.size() < nReadAhead) {
+            const CDiskBlockPos pos = pindexNextRead->GetBlockPos();
+            const int nHeight = pindexNextRead->nHeight;
+            const uint256 hash = pindexNextRead->GetBlockHash();
+            auto result = workerPool.push([this, pos, nHeight, hash, &consensusParams](int) {
+                auto scanned = std::make_shared<CRescanBlock>();
+                if (!ReadBlockFromDisk(scanned->block, pos, nHeight, consensusParams))
+                    return CRescanBlockRef(scanned);
+                if (scanned->block.GetHash() != hash) {
+                    error("ScanForWalletTransactions: GetHash() doesn't match index for block %s at %s", hash.ToString(), pos.ToString());
+                    return CRescanBlockRef(scanned);
                 }
-                if (!ret) {
-                    ret = pindex;
-                }
-            } else {
+                CWalletDB walletdb(strWalletFile, "r");
+                scanned->vPotentiallyMine.reserve(scanned->block.vtx.size());
+                for (const CTransactionRef& tx : scanned->block.vtx)
+                    scanned->vPotentiallyMine.push_back(IsPotentiallyMine(*tx, walletdb));
+                scanned->fRead = true;
+                return CRescanBlockRef(scanned);
+            });
+            pending.push_back(CRescanPending{pindexNextRead, nKeyStoreUpdateCounter, std::move(result)});
+            pindexNextRead = chainActive.Next(pindexNextRead);
+        }
+    };
+
+    // Transparent inputs are matched here as mapWallet grows while we scan
+    auto isTouchingWallet = [this](const CTransaction& tx) {
+        if (mapWallet.count(tx.GetHash()))
+            return true;
+        for (const CTxIn& txin : tx.vin) {
+            if (mapWallet.count(txin.prevout.hash) || mapTxSpends.count(txin.prevout))
+                return true;
+        }
+        return false;
+    };
+
+    readAhead();
+    while (!pending.empty())
+    {
+        // A temporary fix for inability to Ctrl-C rescan when restoring a wallet (will be fixed in 0.15.)
+        if (ShutdownRequested()) {
+            workerPool.clear_queue();
+            return nullptr;
+        }
+
+        CRescanPending next = std::move(pending.front());
+        pending.pop_front();
+        pindex = next.pindex;
+
+        if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+            ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+        if (GetTime() >= nNow + 60) {
+            nNow = GetTime();
+            LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
+        }
+
+        CRescanBlockRef scanned = next.result.get();
+        if (scanned->fRead) {
+            LOCK2(cs_main, cs_wallet);
+            if (!chainActive.Contains(pindex)) {
+                // Abort scan if current block is no longer active, to prevent
+                // marking transactions as coming from the wrong block.
                 ret = nullptr;
+                break;
+            }
+
+            // Keys added since the block was handed out (e.g. keypool top up on
+            // a restored backup) are unknown to the filter, so from then on every
+            // transaction of the block goes through the full check
+            bool fStale = false;
+            const std::vector<CTransactionRef>& vtx = scanned->block.vtx;
+            for (size_t posInBlock = 0; posInBlock < vtx.size(); ++posInBlock) {
+                fStale = fStale || nKeyStoreUpdateCounter != next.nKeyStoreUpdateCounter;
+                if (fStale || scanned->vPotentiallyMine[posInBlock] || isTouchingWallet(*vtx[posInBlock]))
+                    AddToWalletIfInvolvingMe(*vtx[posInBlock], pindex, posInBlock, fUpdate);
+            }
+            if (!ret) {
+                ret = pindex;
             }
-            pindex = chainActive.Next(pindex);
+
+            if (fStale || nKeyStoreUpdateCounter != next.nKeyStoreUpdateCounter) {
+                // Results read ahead are stale as well, hand the blocks out again
+                workerPool.clear_queue();
+                pending.clear();
+                pindexNextRead = chainActive.Next(pindex);
+            }
+        } else {
+            ret = nullptr;
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+
+        readAhead();
     }
+    workerPool.clear_queue();
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     return ret;
 }
 
@@ -2650,48 +2803,13 @@ std::pair<CAmount, CAmount> CWallet::GetPrivateBalance(size_t &confirmed, size_t
     if(!zwallet)
         return balance;
 
-    auto lelantusCoins = zwallet->GetTracker().ListLelantusMints(true, false, false);
-    for (auto const &c : lelantusCoins) {
-
-        if (c.isUsed || c.isArchived || !c.isSeedCorrect) {
-            continue;
-        }
-
-        auto conf = c.nHeight > 0
-            ? chainActive.Height() - c.nHeight + 1 : 0;
-
-        if (conf >= ZC_MINT_CONFIRMATIONS) {
-            confirmed++;
-            balance.first += c.amount;
-        } else {
-            unconfirmed++;
-            balance.second += c.amount;
-        }
-    }
-
-    auto sigmaCoins = zwallet->GetTracker().ListMints(true, false, false);
-    for (auto const &c : sigmaCoins) {
-
-        if (c.isUsed || c.isArchived || !c.isSeedCorrect) {
-            continue;
-        }
-
-        CAmount amount;
-        if (!sigma::DenominationToInteger(c.denom, amount)) {
-            throw std::runtime_error("Fail to get denomination value");
-        }
+    // Maintained by the tracker as mints get added and updated
+    CPrivateBalance privateBalance = zwallet->GetTracker().GetPrivateBalance();
 
-        auto conf = c.nHeight > 0
-            ? chainActive.Height() - c.nHeight + 1 : 0;
-
-        if (conf >= ZC_MINT_CONFIRMATIONS) {
-            confirmed++;
-            balance.first += amount;
-        } else {
-            unconfirmed++;
-            balance.second += amount;
-        }
-    }
+    confirmed = privateBalance.nConfirmed;
+    unconfirmed = privateBalance.nUnconfirmed;
+    balance.first = privateBalance.confirmed;
+    balance.second = privateBalance.unconfirmed;
 
     return balance;
 }
@@ -2990,6 +3108,69 @@ std::list<CSigmaEntry> CWallet::GetAvailableCoins(const CCoinControl *coinContro
     return coins;
 }
 
+// Checks whether a Lelantus mint can be spent now, cs_main has to be held.
+// Filters out coins which are not confirmed, I.E. do not have at least 2 blocks
+// above them, after they were minted, or are in a too small anonymity set.
+// Also filters out locked coins and coins that have not been selected from
+// CoinControl should that be used.
+static bool IsLelantusCoinSpendable(
+        const GroupElement& value,
+        const std::set<COutPoint>& lockedCoins,
+        const CCoinControl *coinControl,
+        bool includeUnsafe)
+{
+    AssertLockHeld(cs_main);
+    lelantus::CLelantusState* state = lelantus::CLelantusState::GetState();
+
+    int coinHeight, coinId;
+    std::tie(coinHeight, coinId) =  state->GetMintedCoinHeightAndId(lelantus::PublicCoin(value));
+
+    // Check group size
+    uint256 hashOut;
+    std::vector<lelantus::PublicCoin> coinOuts;
+    std::vector<unsigned char> setHash;
+    state->GetCoinSetForSpend(
+        &chainActive,
+        chainActive.Height() - (ZC_MINT_CONFIRMATIONS - 1), // required 1 confirmation for mint to spend
+        coinId,
+        hashOut,
+        coinOuts,
+        setHash
+    );
+
+    if (!includeUnsafe && coinOuts.size() < 2) {
+        return false;
+    }
+
+    if (coinHeight == -1) {
+        // Coin still in the mempool.
+        return false;
+    }
+
+    if (coinHeight + (ZC_MINT_CONFIRMATIONS - 1) > chainActive.Height()) {
+        // Does not have the required number of confirmations.
+        return false;
+    }
+
+    COutPoint outPoint;
+    lelantus::PublicCoin pubCoin(value);
+    lelantus::GetOutPoint(outPoint, pubCoin);
+
+    if(lockedCoins.count(outPoint) > 0){
+        return false;
+    }
+
+    if(coinControl != NULL){
+        if(coinControl->HasSelected()){
+            if(!coinControl->IsSelected(outPoint)){
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 std::list<CLelantusEntry> CWallet::GetAvailableLelantusCoins(const CCoinControl *coinControl, bool includeUnsafe, bool forEstimation) const {
     EnsureMintWalletAvailable();
 
@@ -3006,85 +3187,75 @@ std::list<CLelantusEntry> CWallet::GetAvailableLelantusCoins(const CCoinControl
 
     std::set<COutPoint> lockedCoins = setLockedCoins;
 
-    // Filter out coins which are not confirmed, I.E. do not have at least 2 blocks
-    // above them, after they were minted.
-    // Also filter out used coins.
-    // Finally filter out coins that have not been selected from CoinControl should that be used
-    coins.remove_if([lockedCoins, coinControl, includeUnsafe](const CLelantusEntry& coin) {
-        lelantus::CLelantusState* state = lelantus::CLelantusState::GetState();
-        if (coin.IsUsed)
-            return true;
-
-        int coinHeight, coinId;
-        std::tie(coinHeight, coinId) =  state->GetMintedCoinHeightAndId(lelantus::PublicCoin(coin.value));
+    // Filter out used coins and coins which can't be spent yet
+    coins.remove_if([&lockedCoins, coinControl, includeUnsafe](const CLelantusEntry& coin) {
+        return coin.IsUsed || !IsLelantusCoinSpendable(coin.value, lockedCoins, coinControl, includeUnsafe);
+    });
 
-        // Check group size
-        uint256 hashOut;
-        std::vector<lelantus::PublicCoin> coinOuts;
-        std::vector<unsigned char> setHash;
-        state->GetCoinSetForSpend(
-            &chainActive,
-            chainActive.Height() - (ZC_MINT_CONFIRMATIONS - 1), // required 1 confirmation for mint to spend
-            coinId,
-            hashOut,
-            coinOuts,
-            setHash
-        );
+    return coins;
+}
 
-        if (!includeUnsafe && coinOuts.size() < 2) {
-            return true;
-        }
+void CWallet::GetMintValueKeys(const std::vector<GroupElement>& pubcoins, std::vector<CKeyingMaterial>& keys) const {
+    keys.assign(pubcoins.size(), CKeyingMaterial());
 
-        if (coinHeight == -1) {
-            // Coin still in the mempool.
-            return true;
-        }
+    std::vector<uint32_t> keyPaths;
+    keyPaths.reserve(pubcoins.size());
+    for (const GroupElement& pubcoin : pubcoins)
+        keyPaths.push_back(primitives::GetPubCoinValueHash(pubcoin).GetFirstUint32());
 
-        if (coinHeight + (ZC_MINT_CONFIRMATIONS - 1) > chainActive.Height()) {
-            // Remove the coin from the candidates list, since it does not have the
-            // required number of confirmations.
-            return true;
+    std::vector<size_t> missing;
+    {
+        LOCK(cs_mintValueKeys);
+        for (size_t i = 0; i < keyPaths.size(); i++) {
+            if (!mapMintValueKeys.get(keyPaths[i], keys[i]))
+                missing.push_back(i);
         }
+    }
 
-        COutPoint outPoint;
-        lelantus::PublicCoin pubCoin(coin.value);
-        lelantus::GetOutPoint(outPoint, pubCoin);
-
-        if(lockedCoins.count(outPoint) > 0){
-            return true;
-        }
+    if (missing.empty())
+        return;
 
-        if(coinControl != NULL){
-            if(coinControl->HasSelected()){
-                if(!coinControl->IsSelected(outPoint)){
-                    return true;
-                }
+    std::map<uint32_t, CKeyingMaterial> derived;
+    {
+        LOCK(cs_wallet);
+        for (size_t i : missing) {
+            auto it = derived.find(keyPaths[i]);
+            if (it == derived.end()) {
+                CKey secret;
+                const_cast<CWallet*>(this)->GetKeyFromKeypath(BIP44_MINT_VALUE_INDEX, keyPaths[i], secret);
+
+                CKeyingMaterial result(CHMAC_SHA512::OUTPUT_SIZE);
+                CHMAC_SHA512(secret.begin(), secret.size()).Finalize(&result[0]);
+                result.resize(AES256_KEYSIZE);
+                it = derived.emplace(keyPaths[i], std::move(result)).first;
             }
+            keys[i] = it->second;
         }
+    }
 
-        return false;
-    });
-
-    return coins;
-}
-
-std::vector<unsigned char> GetAESKey(const secp_primitives::GroupElement& pubcoin) {
-    uint32_t keyPath = primitives::GetPubCoinValueHash(pubcoin).GetFirstUint32();
-    CKey secret;
-    {
-        pwalletMain->GetKeyFromKeypath(BIP44_MINT_VALUE_INDEX, keyPath, secret);
+    LOCK(cs_mintValueKeys);
+    // Lock() clears the cache after locking the keystore, don't refill it afterwards
+    if (!IsLocked()) {
+        for (const auto& key : derived)
+            mapMintValueKeys.insert(key.first, key.second);
     }
+}
 
-    std::vector<unsigned char> result(CHMAC_SHA512::OUTPUT_SIZE);
+void CWallet::ClearMintValueKeys() const {
+    LOCK(cs_mintValueKeys);
+    mapMintValueKeys.clear();
+}
 
-    CHMAC_SHA512(secret.begin(), secret.size()).Finalize(&result[0]);
+bool CWallet::Lock() {
+    bool result = CCryptoKeyStore::Lock();
+    ClearMintValueKeys();
     return result;
 }
 
 std::vector<unsigned char> CWallet::EncryptMintAmount(uint64_t amount, const secp_primitives::GroupElement& pubcoin) const {
-    LOCK(cs_wallet);
-    std::vector<unsigned char> key = GetAESKey(pubcoin);
-    AES256Encrypt enc(key.data());
+    std::vector<CKeyingMaterial> keys;
+    GetMintValueKeys({pubcoin}, keys);
+    AES256Encrypt enc(keys[0].data());
     std::vector<unsigned char> ciphertext(16);
     std::vector<unsigned char> plaintext(16);
     memcpy(plaintext.data(), &amount, 8);
@@ -3093,18 +3264,38 @@ std::vector<unsigned char> CWallet::EncryptMintAmount(uint64_t amount, const sec
 }
 
 bool CWallet::DecryptMintAmount(const std::vector<unsigned char>& encryptedValue, const secp_primitives::GroupElement& pubcoin, uint64_t& amount) const {
-    if (IsLocked() || hdChain.masterKeyID.IsNull()) {
-        amount = 0;
+    std::vector<uint64_t> amounts;
+    bool result = DecryptMintAmounts({std::make_pair(encryptedValue, pubcoin)}, amounts);
+    amount = amounts[0];
+    return result;
+}
+
+bool CWallet::DecryptMintAmounts(const std::vector<std::pair<std::vector<unsigned char>, secp_primitives::GroupElement>>& encryptedValues, std::vector<uint64_t>& amounts) const {
+    amounts.assign(encryptedValues.size(), 0);
+    if (IsLocked() || hdChain.masterKeyID.IsNull())
         return true;
-    }
 
-    LOCK(cs_wallet);
-    std::vector<unsigned char> key = GetAESKey(pubcoin);
-    AES256Decrypt dec(key.data());
-    std::vector<unsigned char> plaintext(16);
-    dec.Decrypt(plaintext.data(), encryptedValue.data());
-    memcpy(&amount, plaintext.data(), 8);
-    return true;
+    std::vector<GroupElement> pubcoins;
+    pubcoins.reserve(encryptedValues.size());
+    for (const auto& value : encryptedValues)
+        pubcoins.push_back(value.second);
+
+    std::vector<CKeyingMaterial> keys;
+    GetMintValueKeys(pubcoins, keys);
+
+    bool result = true;
+    unsigned char plaintext[AES_BLOCKSIZE];
+    for (size_t i = 0; i < encryptedValues.size(); i++) {
+        if (encryptedValues[i].first.size() < AES_BLOCKSIZE) {
+            result = false;
+            continue;
+        }
+        AES256Decrypt dec(keys[i].data());
+        dec.Decrypt(plaintext, encryptedValues[i].first.data());
+        memcpy(&amounts[i], plaintext, 8);
+    }
+    memory_cleanse(plaintext, sizeof(plaintext));
+    return result;
 }
 
 
@@ -3256,87 +3447,77 @@ bool CWallet::GetCoinsToSpend(
     return true;
 }
 
-bool CWallet::GetCoinsToJoinSplit(
+std::vector<CLelantusMintMeta> CWallet::SelectLelantusMintsToJoinSplit(
         CAmount required,
-        std::vector<CLelantusEntry>& coinsToSpend_out,
-        CAmount& changeToMint,
-        std::list<CLelantusEntry> coins,
-        const size_t coinsToSpendLimit,
-        const CAmount amountToSpendLimit,
         const CCoinControl *coinControl) const
 {
-
     EnsureMintWalletAvailable();
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
     const Consensus::Params &consensusParams = Params().GetConsensus();
 
     if (required > consensusParams.nMaxValueLelantusSpendPerTransaction) {
         throw std::invalid_argument(_("The required amount exceeds spend limit"));
     }
 
-    CAmount availableBalance = CalculateLelantusCoinsBalance(coins.begin(), coins.end());
-
-    if (required > availableBalance) {
-        throw InsufficientFunds();
-    }
-
-    // sort by biggest amount. if it is same amount we will prefer the older block
-    auto comparer = [](const CLelantusEntry& a, const CLelantusEntry& b) -> bool {
-        return a.amount != b.amount ? a.amount > b.amount : a.nHeight < b.nHeight;
+    const std::set<COutPoint>& lockedCoins = setLockedCoins;
+    auto isSpendable = [&lockedCoins, coinControl](const CLelantusMintMeta& meta) {
+        return IsLelantusCoinSpendable(meta.GetPubCoinValue(), lockedCoins, coinControl, false);
     };
-    coins.sort(comparer);
 
+    std::vector<CLelantusMintMeta> selected;
     CAmount spend_val(0);
 
-    std::list<CLelantusEntry> coinsToSpend;
-
     // If coinControl, want to use all inputs
-    bool coinControlUsed = false;
-    if(coinControl != NULL) {
-        if(coinControl->HasSelected()) {
-            auto coinIt = coins.rbegin();
-            for (; coinIt != coins.rend(); coinIt++) {
-                spend_val += coinIt->amount;
+    if (coinControl != NULL && coinControl->HasSelected()) {
+        for (const CLelantusMintMeta& meta : zwallet->GetTracker().ListLelantusMints(true, true, false)) {
+            if (meta.amount != 0 && isSpendable(meta)) {
+                spend_val += meta.amount;
+                selected.push_back(meta);
             }
-            coinControlUsed = true;
-            coinsToSpend.insert(coinsToSpend.begin(), coins.begin(), coins.end());
         }
+    } else {
+        selected = zwallet->GetTracker().SelectLelantusMints(required, isSpendable);
+        for (const CLelantusMintMeta& meta : selected)
+            spend_val += meta.amount;
     }
 
-    if(!coinControlUsed) {
-        while (spend_val < required) {
-            if(coins.empty())
-                break;
+    if (required > spend_val) {
+        throw InsufficientFunds();
+    }
 
-            CLelantusEntry choosen;
-            CAmount need = required - spend_val;
+    return selected;
+}
 
-            auto itr = coins.begin();
-            if(need >= itr->amount) {
-                choosen = *itr;
-                coins.erase(itr);
-            } else {
-                for (auto coinIt = coins.rbegin(); coinIt != coins.rend(); coinIt++) {
-                    auto nextItr = coinIt;
-                    nextItr++;
+bool CWallet::GetCoinsToJoinSplit(
+        CAmount required,
+        std::vector<CLelantusEntry>& coinsToSpend_out,
+        CAmount& changeToMint,
+        const size_t coinsToSpendLimit,
+        const CAmount amountToSpendLimit,
+        const CCoinControl *coinControl) const
+{
+    LOCK2(cs_main, cs_wallet);
 
-                    if (coinIt->amount >= need && (nextItr == coins.rend() || nextItr->amount != coinIt->amount)) {
-                        choosen = *coinIt;
-                        coins.erase(std::next(coinIt).base());
-                        break;
-                    }
-                }
-            }
+    // Only the chosen coins are read from the database
+    std::vector<CLelantusMintMeta> selected = SelectLelantusMintsToJoinSplit(required, coinControl);
 
-            spend_val += choosen.amount;
-            coinsToSpend.push_back(choosen);
-        }
+    CAmount spend_val(0);
+    std::vector<CLelantusEntry> coinsToSpend;
+    coinsToSpend.reserve(selected.size());
+    for (const CLelantusMintMeta& meta : selected) {
+        CLelantusEntry entry;
+        if (!GetMint(meta.hashSerial, entry))
+            throw std::runtime_error(_("Unable to read the selected Lelantus mint"));
+        spend_val += entry.amount;
+        coinsToSpend.push_back(entry);
     }
 
     // sort by group id ay ascending order. it is mandatory for creting proper joinsplit
     auto idComparer = [](const CLelantusEntry& a, const CLelantusEntry& b) -> bool {
         return a.id < b.id;
     };
-    coinsToSpend.sort(idComparer);
+    std::stable_sort(coinsToSpend.begin(), coinsToSpend.end(), idComparer);
 
     changeToMint = spend_val - required;
     coinsToSpend_out.insert(coinsToSpend_out.begin(), coinsToSpend.begin(), coinsToSpend.end());
@@ -5457,11 +5638,10 @@ std::pair<CAmount, unsigned int> CWallet::EstimateJoinSplitFee(
         CAmount required,
         bool subtractFeeFromAmount,
         std::list<CSigmaEntry> sigmaCoins,
-        std::list<CLelantusEntry> coins,
         const CCoinControl *coinControl) {
     CAmount fee;
     unsigned size;
-    std::vector<CLelantusEntry> spendCoins;
+    size_t nLelantusInputs;
     std::vector<CSigmaEntry> sigmaSpendCoins;
 
     CAmount availableSigmaBalance(0);
@@ -5475,10 +5655,9 @@ std::pair<CAmount, unsigned int> CWallet::EstimateJoinSplitFee(
         if (!subtractFeeFromAmount)
             currentRequired += fee;
 
-        spendCoins.clear();
+        nLelantusInputs = 0;
         sigmaSpendCoins.clear();
         const auto &consensusParams = Params().GetConsensus();
-        CAmount changeToMint = 0;
 
         std::vector<sigma::CoinDenomination> denomChanges;
         try {
@@ -5495,18 +5674,16 @@ std::pair<CAmount, unsigned int> CWallet::EstimateJoinSplitFee(
             }
 
             if (currentRequired > 0) {
-                if (!this->GetCoinsToJoinSplit(currentRequired, spendCoins, changeToMint, coins,
-                                                consensusParams.nMaxLelantusInputPerTransaction,
-                                                consensusParams.nMaxValueLelantusSpendPerTransaction, coinControl)) {
-                    return std::make_pair(0, 0);
-                }
+                // the selection is enough to size the transaction, mints are not read
+                LOCK2(cs_main, cs_wallet);
+                nLelantusInputs = SelectLelantusMintsToJoinSplit(currentRequired, coinControl).size();
             }
         } catch (std::runtime_error const &) {
         }
 
         // 1054 is constant part, mainly Schnorr and Range proofs, 2560 is for each sigma/aux data
         // 179 other parts of tx, assuming 1 utxo and 1 jmint
-        size = 1054 + 2560 * (spendCoins.size() + sigmaSpendCoins.size()) + 179;
+        size = 1054 + 2560 * (nLelantusInputs + sigmaSpendCoins.size()) + 179;
         CAmount feeNeeded = CWallet::GetMinimumFee(size, nTxConfirmTarget, mempool);
 
         if (fee >= feeNeeded) {
@@ -6517,6 +6694,7 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-paytxfee=<amt>", strprintf(_("Fee (in %s/kB) to add to transactions you send (default: %s)"),
                                                             CURRENCY_UNIT, FormatMoney(payTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-rescan", _("Rescan the block chain for missing wallet transactions on startup"));
+    strUsage += HelpMessageOpt("-rescanthreads=<n>", strprintf(_("Set the number of threads reading and filtering blocks during rescan (%u to %d, 0 = one per core, default: %d)"), 1, MAX_RESCAN_THREADS, DEFAULT_RESCAN_THREADS));
     strUsage += HelpMessageOpt("-salvagewallet", _("Attempt to recover private keys from a corrupt wallet on startup"));
     if (showDebug)
         strUsage += HelpMessageOpt("-sendfreetransactions", strprintf(_("Send transactions as zero-fee transactions if possible (default: %u)"), DEFAULT_SEND_FREE_TRANSACTIONS));
@@ -6534,6 +6712,7 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-wallet=<file>", _("Specify wallet file (within data directory)") + " " + strprintf(_("(default: %s)"), DEFAULT_WALLET_DAT));
     strUsage += HelpMessageOpt("-walletbroadcast", _("Make the wallet broadcast transactions") + " " + strprintf(_("(default: %u)"), DEFAULT_WALLETBROADCAST));
     strUsage += HelpMessageOpt("-walletnotify=<cmd>", _("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)"));
+    strUsage += HelpMessageOpt("-bip47lookahead=<n>", strprintf(_("Number of unused addresses watched in each incoming RAP payment channel (1 to %u, default: %u)"), bip47::MaxAddressLookaheadNumber, bip47::AddressLookaheadNumber));
     strUsage += HelpMessageOpt("-zapwalletmints", _("Delete all Sigma mints and only recover those parts of the blockchain through -reindex on startup"));
     strUsage += HelpMessageOpt("-zapwallettxes=<mode>", _("Delete all wallet transactions and only recover those parts of the blockchain through -rescan on startup") +
                                " " + _("(1 = keep tx meta data e.g. account owner and payment request information, 2 = drop tx meta data)"));
@@ -6858,6 +7037,8 @@ bool CWallet::ParameterInteraction()
         LogPrintf("%s: parameter interaction: -zapwallettxes=<mode> -> setting -rescan=1\n", __func__);
     }
 
+    bip47::SetAddressLookahead(std::max<int64_t>(1, GetArg("-bip47lookahead", bip47::AddressLookaheadNumber)));
+
     if (GetBoolArg("-sysperms", false))
         return InitError("-sysperms is not allowed in combination with enabled wallet functionality");
     if (GetArg("-prune", 0) && GetBoolArg("-rescan", false))
@@ -7152,6 +7333,7 @@ CBitcoinAddress CWallet::GenerateTheirNextAddress(bip47::CPaymentCode const & th
 void CWallet::LoadBip47Wallet()
 {
     CWalletDB(strWalletFile).LoadBip47Accounts(*bip47wallet);
+    bip47wallet->precomputeLookahead(GetNumCores());
 }
 
 std::shared_ptr<bip47::CWallet const> CWallet::GetBip47Wallet() const
@@ -7248,19 +7430,7 @@ bip47::CAccountReceiver const * CWallet::AddressUsed(CBitcoinAddress const & add
     if(!bip47wallet)
         return result;
 
-    bip47wallet->enumerateReceivers(
-        [&address, &result](bip47::CAccountReceiver & rec)->bool
-        {
-            bip47::MyAddrContT addrs = rec.getMyNextAddresses();
-            if (std::find_if(addrs.begin(), addrs.end(), bip47::FindByAddress(address)) != addrs.end())
-            {
-                rec.addressUsed(address);
-                result = &rec;
-                return false;
-            }
-            return true;
-        }
-    );
+    result = bip47wallet->markAddressUsed(address);
     if (result)
         CWalletDB(strWalletFile).WriteBip47Account(*result);
     return result;
@@ -7320,6 +7490,7 @@ void CWallet::HandleBip47Transaction(CWalletTx const & wtx)
 notifTxExit:
     if (success) {
         LogBip47("The payment code has been accepted: %s\n", accFound->lastPcode().toString());
+        bip47wallet->indexReceiver(*accFound);
         HandleSecretAddresses(*this, *accFound);
         CWalletDB(strWalletFile).WriteBip47Account(*accFound);
         LockCoin(COutPoint(wtx.tx->GetHash(), std::distance(wtx.tx->vout.begin(), iregout))); //Locking the notif tx output to be spent only manually
@@ -7428,6 +7599,7 @@ size_t CWallet::SetUsedAddressNumber(bip47::CPaymentCode const & pcode, size_t n
         }
     );
     if(resutRec) {
+        bip47wallet->indexReceiver(*receiver);
         HandleSecretAddresses(*this, *receiver);
         return *resutRec;
     }
@@ -30,6 +30,7 @@
 #include "primitives/mint_spend.h"
 
 #include "bip47/paymentcode.h"
+#include "unordered_lru_cache.h"
 
 
 #include <algorithm>
@@ -86,6 +87,15 @@ static const bool DEFAULT_DISABLE_WALLET = false;
 
 static const bool DEFAULT_UPGRADE_CHAIN = false;
 
+//! -rescanthreads default, 0 = one rescan worker per core
+static const int DEFAULT_RESCAN_THREADS = 0;
+//! Maximum number of rescan workers
+static const int MAX_RESCAN_THREADS = 16;
+//! Number of blocks each rescan worker may read ahead of the block being applied
+static const int RESCAN_BLOCKS_PER_THREAD = 4;
+//! JMint amount AES keys kept in secure memory; foreign mints seen in validation also derive one
+static const size_t MAX_MINT_VALUE_KEYS = 1000;
+
 //! if set, all keys will be derived by using BIP32
 static const bool DEFAULT_USE_HD_WALLET = true;
 
@@ -705,6 +715,31 @@ private:
 
     std::shared_ptr<bip47::CWallet> bip47wallet;
 
+    //! Bumped whenever a key, script or watch-only script is added, so that rescan
+    //! results computed ahead of the scanning cursor can be detected as stale
+    std::atomic<uint64_t> nKeyStoreUpdateCounter{0};
+
+    /**
+     * Checks the outputs and privacy inputs of tx against the keystore and the
+     * HD mint database without taking cs_wallet, so it may run on rescan workers.
+     * Returns false only if tx can not be ours; transparent inputs are matched by
+     * the caller against mapWallet under cs_wallet.
+     */
+    bool IsPotentiallyMine(const CTransaction& tx, CWalletDB& walletdb) const;
+
+    //! Protects mapMintValueKeys, may be taken while holding cs_wallet but not the other way around
+    mutable CCriticalSection cs_mintValueKeys;
+    //! AES keys of JMint amounts by BIP44_MINT_VALUE_INDEX child, least recently used ones
+    //! are dropped past MAX_MINT_VALUE_KEYS, all of them when the wallet is locked
+    mutable unordered_lru_cache<uint32_t, CKeyingMaterial, std::hash<uint32_t>, MAX_MINT_VALUE_KEYS> mapMintValueKeys;
+
+    /**
+     * Fills keys with the JMint amount AES keys of pubcoins. Keys missing from the
+     * cache are derived from the HD chain taking cs_wallet once for all of them.
+     */
+    void GetMintValueKeys(const std::vector<GroupElement>& pubcoins, std::vector<CKeyingMaterial>& keys) const;
+    void ClearMintValueKeys() const;
+
     /**
      * Private version of AddWatchOnly method which does not accept a
      * timestamp, and which will reset the wallet's nTimeFirstKey value to 1 if
@@ -889,6 +924,7 @@ public:
     int64_t nRelockTime;
 
     bool Unlock(const SecureString& strWalletPassphrase, const bool& fFirstUnlock=false);
+    bool Lock() override;
     bool ChangeWalletPassphrase(const SecureString& strOldWalletPassphrase, const SecureString& strNewWalletPassphrase);
     bool EncryptWallet(const SecureString& strWalletPassphrase);
 
@@ -955,6 +991,13 @@ public:
 
     bool DecryptMintAmount(const std::vector<unsigned char>& encryptedValue, const secp_primitives::GroupElement& pubcoin, uint64_t& amount) const;
 
+    /**
+     * Decrypts the amounts of many JMint outputs given as (encrypted value, pubcoin) pairs.
+     * Keys come from the session cache, so cs_wallet is not taken per output. Amounts are
+     * 0 while the wallet is locked; returns false if some encrypted value is malformed.
+     */
+    bool DecryptMintAmounts(const std::vector<std::pair<std::vector<unsigned char>, secp_primitives::GroupElement>>& encryptedValues, std::vector<uint64_t>& amounts) const;
+
 
     /** \brief Selects coins to spend, and coins to re-mint based on the required amount to spend, provided by the user. As the lower denomination now is 0.1 firo, user's request will be rounded up to the nearest 0.1. This difference between the user's requested value, and the actually spent value will be left to the miners as a fee.
      * \param[in] required Required amount to spend.
@@ -971,11 +1014,16 @@ public:
         const CAmount amountLimit = MAX_MONEY,
         const CCoinControl *coinControl = NULL) const;
 
+    /** Selects spendable Lelantus mints covering the required amount from the tracker's
+     * amount index, without reading them from the database. cs_main and cs_wallet have to be held.
+     * \throws InsufficientFunds if the spendable mints do not cover the required amount.
+     */
+    std::vector<CLelantusMintMeta> SelectLelantusMintsToJoinSplit(CAmount required, const CCoinControl *coinControl = NULL) const;
+
     bool GetCoinsToJoinSplit(
             CAmount required,
             std::vector<CLelantusEntry>& coinsToSpend_out,
             CAmount& changeToMint,
-            std::list<CLelantusEntry> coins,
             const size_t coinsToSpendLimit = SIZE_MAX,
             const CAmount amountToSpendLimit = MAX_MONEY,
             const CCoinControl *coinControl = NULL) const;
@@ -1053,7 +1101,7 @@ public:
 
     std::vector<CLelantusEntry> JoinSplitLelantus(const std::vector<CRecipient>& recipients, const std::vector<CAmount>& newMints, CWalletTx& result);
 
-    std::pair<CAmount, unsigned int> EstimateJoinSplitFee(CAmount required, bool subtractFeeFromAmount, std::list<CSigmaEntry> sigmaCoins, std::list<CLelantusEntry> coins, const CCoinControl *coinControl);
+    std::pair<CAmount, unsigned int> EstimateJoinSplitFee(CAmount required, bool subtractFeeFromAmount, std::list<CSigmaEntry> sigmaCoins, const CCoinControl *coinControl);
 
     bool GetMint(const uint256& hashSerial, CSigmaEntry& sigmaEntry, bool forEstimation = false) const;
 
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chainparams.h"
+#include "net.h"
 #include "streams.h"
 #include "zmqpublishnotifier.h"
 #include "validation.h"
@@ -15,6 +16,7 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_NETMSGSTATS = "netmsgstats";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -191,3 +193,13 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishNetMsgStatsNotifier::NotifyBlock(const CBlockIndex *pindex)
+{
+    if (!g_connman)
+        return true;
+    LogPrint("zmq", "zmq: Publish netmsgstats at %s\n", pindex->GetBlockHash().GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << g_connman->GetMsgStats().GetStats();
+    return SendMessage(MSG_NETMSGSTATS, &(*ss.begin()), ss.size());
+}
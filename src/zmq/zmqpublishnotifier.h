@@ -52,4 +52,11 @@ public:
     bool NotifyTransaction(const CTransaction &transaction);
 };
 
+/** Publishes the message handler statistics (CNetMsgStats) on every new tip */
+class CZMQPublishNetMsgStatsNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlock(const CBlockIndex *pindex);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H